@@ -0,0 +1,275 @@
+/**
+ * colocbench.c
+ *
+ * Usage:
+ * mpiexec -nfg <X> -n <Y> ./colocbench [ -i <iterations> ] [ -w <window> ] [ -f <table file> ]
+ *
+ * Baseline message costs to read the election timings against. Ranks are
+ * placed as for the election programs: FG-MPI puts -nfg consecutive ranks in
+ * each OS process, so of the ring links r -> r+1 the ones inside an OS
+ * process are local and the rest, one per OS process when -n > 1, are cross.
+ * Each link is measured from its left end, a third of the ring at a time (by
+ * parity, the odd ring's last link on its own) so no rank is in two pairs:
+ *   pingpong  half the round trip of a 12 byte message (hs's), <iterations>
+ *             times (default 1000)
+ *   isend     messages per second for 8, 12, 16 and 24 byte messages, the
+ *             election's sizes: <iterations> windows of <window> (default
+ *             16) MPI_Isends, each window acknowledged
+ * and then the ring as a whole:
+ *   token     one token passed round the ring <iterations> hops: seconds a hop
+ *   tokens    every rank passing <iterations> tokens at once: hops a second,
+ *             the whole ring
+ *   yield     MPIX_Yield <iterations> times on every rank: seconds a switch
+ *             between co-located processes
+ * Rank 0 prints a table, one row per metric, class and message size, with
+ * the number of links (or ranks) measured and the mean, smallest and largest
+ * over them; -f writes it to a file too. An election time divided by the
+ * pingpong or token row of the same -nfg and -n is in hops, which compares
+ * across placements.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+
+// Tags
+#define TAG_PING 2
+#define TAG_PONG 3
+#define TAG_DATA 4
+#define TAG_ACK 5
+#define TAG_TOKEN 6
+
+#define SIZE_MSG 3   // ints, hs's election message
+#define MAX_MSG 6    // ints, the largest isend size
+#define MAX_WINDOW 1024
+
+static const int isend_sizes[] = { 2, 3, 4, 6 }; // ints: 8 to 24 bytes
+#define ISEND_SIZES 4
+
+// Link classes
+enum { LOCAL, CROSS, CLASSES };
+static const char *class_names[] = { "local", "cross" };
+
+// Table rows
+enum { ROW_PINGPONG, ROW_ISEND = ROW_PINGPONG + CLASSES, ROW_TOKEN = ROW_ISEND + CLASSES * ISEND_SIZES,
+       ROW_TOKENS, ROW_YIELD, ROWS };
+
+typedef struct {
+  double sum[ROWS + 1], count[ROWS]; // sum[ROWS] counts OS processes
+  double min[ROWS], max[ROWS];
+} results_t;
+
+/** FG-MPI Boilerplate begins **/
+int colocbench(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&colocbench);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+/** Whether rank r measures its link to r + 1 in round k (0, 1, then 2 for the odd ring's last link). */
+static int measures(int r, int size, int k) {
+  if (size % 2 && r == size - 1) return k == 2;
+  return r % 2 == k;
+}
+
+static void add(results_t *res, int row, double value) {
+  res->sum[row] += value;
+  if (!res->count[row]++) res->min[row] = res->max[row] = value;
+  if (value < res->min[row]) res->min[row] = value;
+  if (value > res->max[row]) res->max[row] = value;
+}
+
+/** Ping-pong over the link to right (measuring) or from left. Returns seconds a hop. */
+static double pingpong(int measuring, int left, int right, int iterations, MPI_Comm comm) {
+  int buf[SIZE_MSG] = { 0 }, i;
+  double t0 = MPI_Wtime();
+
+  for (i = 0; i < iterations; i++) {
+    if (measuring) {
+      MPI_Send(buf, SIZE_MSG, MPI_INT, right, TAG_PING, comm);
+      MPI_Recv(buf, SIZE_MSG, MPI_INT, right, TAG_PONG, comm, MPI_STATUS_IGNORE);
+    } else {
+      MPI_Recv(buf, SIZE_MSG, MPI_INT, left, TAG_PING, comm, MPI_STATUS_IGNORE);
+      MPI_Send(buf, SIZE_MSG, MPI_INT, left, TAG_PONG, comm);
+    }
+  }
+  return (MPI_Wtime() - t0) / (2.0 * iterations);
+}
+
+/** Windows of Isends of count ints to right (measuring) or Irecvs from left. Returns messages a second. */
+static double isend(int measuring, int left, int right, int count, int window, int iterations,
+                    int (*bufs)[MAX_MSG], MPI_Request *reqs, MPI_Comm comm) {
+  int i, j, ack = 0;
+  double t0 = MPI_Wtime();
+
+  for (i = 0; i < iterations; i++) {
+    for (j = 0; j < window; j++) {
+      if (measuring) MPI_Isend(bufs[j], count, MPI_INT, right, TAG_DATA, comm, &reqs[j]);
+      else MPI_Irecv(bufs[j], count, MPI_INT, left, TAG_DATA, comm, &reqs[j]);
+    }
+    MPI_Waitall(window, reqs, MPI_STATUSES_IGNORE);
+    if (measuring) MPI_Recv(&ack, 1, MPI_INT, right, TAG_ACK, comm, MPI_STATUS_IGNORE);
+    else MPI_Send(&ack, 1, MPI_INT, left, TAG_ACK, comm);
+  }
+  return (double) window * iterations / (MPI_Wtime() - t0);
+}
+
+static void print_table(FILE *out, const results_t *res, int size, int nfg, int iterations, int window) {
+  int row;
+
+  fprintf(out, "# colocbench: ranks=%d, nfg=%d, os_procs=%.0f, iterations=%d, window=%d\n", size, nfg,
+          res->sum[ROWS], iterations, window);
+  fprintf(out, "# %-8s %-6s %5s %6s %12s %12s %12s  %s\n", "metric", "class", "bytes", "n", "mean", "min",
+          "max", "unit");
+  for (row = 0; row < ROWS; row++) {
+    const char *metric, *class = "ring", *unit;
+    int bytes = SIZE_MSG * sizeof(int);
+
+    if (!res->count[row]) continue;
+    if (row < ROW_ISEND) {
+      metric = "pingpong", class = class_names[row - ROW_PINGPONG], unit = "s/hop";
+    } else if (row < ROW_TOKEN) {
+      metric = "isend", class = class_names[(row - ROW_ISEND) % CLASSES], unit = "msgs/s";
+      bytes = isend_sizes[(row - ROW_ISEND) / CLASSES] * sizeof(int);
+    } else if (row == ROW_TOKEN) {
+      metric = "token", unit = "s/hop";
+    } else if (row == ROW_TOKENS) {
+      metric = "tokens", unit = "hops/s";
+    } else {
+      metric = "yield", class = "local", bytes = 0, unit = "s/switch";
+    }
+    fprintf(out, "%-10s %-6s %5d %6.0f %12.4g %12.4g %12.4g  %s\n", metric, class, bytes, res->count[row],
+            res->sum[row] / res->count[row], res->min[row], res->max[row], unit);
+  }
+}
+
+int colocbench(int argc, char *argv[]) {
+  int iterations = 1000, window = 16;
+  const char *path = NULL;
+
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-i")) {
+      iterations = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-w")) {
+      window = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-f")) {
+      path = argv[2];
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 1 || iterations < 1 || window < 1 || window > MAX_WINDOW) {
+    printf("Usage: ./colocbench [ -i <iterations> ] [ -w <window> ] [ -f <table file> ]\n");
+    exit(1);
+  }
+
+  int rank, size, start, nfg, k, s;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPIX_Get_collocated_startrank(&start);
+  MPIX_Get_collocated_size(&nfg);
+  if (size < 2) {
+    printf("Usage: colocbench needs at least 2 processes\n");
+    exit(1);
+  }
+
+  int left = rank ? rank - 1 : size - 1, right = (rank + 1) % size;
+  int class = right >= start && right < start + nfg ? LOCAL : CROSS;
+  int (*bufs)[MAX_MSG] = calloc(window, sizeof(*bufs));
+  MPI_Request *reqs = malloc(window * sizeof(MPI_Request));
+  results_t res, total;
+  memset(&res, 0, sizeof(res));
+  res.sum[ROWS] = rank == start;
+  if (!bufs || !reqs) {
+    printf("colocbench: out of memory\n");
+    exit(1);
+  }
+
+  // Link by link, a round at a time
+  for (k = 0; k < 3; k++) {
+    int measuring = measures(rank, size, k), answering = measures(left, size, k);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (!measuring && !answering) continue;
+    double hop = pingpong(measuring, left, right, iterations, MPI_COMM_WORLD);
+    if (measuring) add(&res, ROW_PINGPONG + class, hop);
+    for (s = 0; s < ISEND_SIZES; s++) {
+      double rate = isend(measuring, left, right, isend_sizes[s], window, iterations, bufs, reqs, MPI_COMM_WORLD);
+      if (measuring) add(&res, ROW_ISEND + s * CLASSES + class, rate);
+    }
+  }
+
+  // One token round the ring, from rank 0
+  int token[SIZE_MSG] = { 0 }, in[SIZE_MSG], i;
+  int laps = iterations / size > 0 ? iterations / size : 1;
+  MPI_Barrier(MPI_COMM_WORLD);
+  double t0 = MPI_Wtime();
+  for (i = 0; i < laps; i++) {
+    if (rank) MPI_Recv(token, SIZE_MSG, MPI_INT, left, TAG_TOKEN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Send(token, SIZE_MSG, MPI_INT, right, TAG_TOKEN, MPI_COMM_WORLD);
+    if (!rank) MPI_Recv(token, SIZE_MSG, MPI_INT, left, TAG_TOKEN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+  if (!rank) add(&res, ROW_TOKEN, (MPI_Wtime() - t0) / ((double) laps * size));
+
+  // Every rank's token at once; the receive is posted before the send, so no
+  // send waits on a neighbour that is itself sending
+  MPI_Request request;
+  MPI_Barrier(MPI_COMM_WORLD);
+  t0 = MPI_Wtime();
+  for (i = 0; i < iterations; i++) {
+    MPI_Irecv(in, SIZE_MSG, MPI_INT, left, TAG_TOKEN, MPI_COMM_WORLD, &request);
+    MPI_Send(token, SIZE_MSG, MPI_INT, right, TAG_TOKEN, MPI_COMM_WORLD);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    memcpy(token, in, sizeof(token));
+  }
+  double elapsed = MPI_Wtime() - t0, longest;
+  MPI_Allreduce(&elapsed, &longest, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  if (!rank) add(&res, ROW_TOKENS, (double) size * iterations / longest);
+
+  // Yields; with every co-located process yielding, each one is a switch
+  MPI_Barrier(MPI_COMM_WORLD);
+  t0 = MPI_Wtime();
+  for (i = 0; i < iterations; i++) MPIX_Yield();
+  add(&res, ROW_YIELD, (MPI_Wtime() - t0) / ((double) iterations * nfg));
+
+  MPI_Reduce(res.sum, total.sum, ROWS + 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce(res.count, total.count, ROWS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  // A row a rank has no value for mustn't win the minimum or maximum
+  for (k = 0; k < ROWS; k++) {
+    if (!res.count[k]) res.min[k] = 1e300, res.max[k] = -1e300;
+  }
+  MPI_Reduce(res.min, total.min, ROWS, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(res.max, total.max, ROWS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  if (!rank) {
+    print_table(stdout, &total, size, nfg, iterations, window);
+    if (path) {
+      FILE *f = fopen(path, "w");
+      if (!f) {
+        printf("colocbench: cannot write %s\n", path);
+      } else {
+        print_table(f, &total, size, nfg, iterations, window);
+        fclose(f);
+      }
+    }
+  }
+
+  free(bufs), free(reqs);
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ * announce.c
+ *
+ * Ring, binomial tree or MPI_Ibcast announcement of the leader.
+ */
+
+#include <string.h>
+#include "announce.h"
+
+static const char *names[] = { "ring", "tree", "ibcast" };
+
+int announce_parse(const char *s, announce_mode_t *mode) {
+  int m;
+  for (m = ANNOUNCE_RING; m <= ANNOUNCE_IBCAST; m++) {
+    if (!strcmp(s, names[m])) {
+      *mode = (announce_mode_t) m;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char *announce_name(announce_mode_t mode) {
+  return names[mode];
+}
+
+void announce_init(announce_t *a, announce_mode_t mode, recv_t *recv, MPI_Comm comm) {
+  a->mode = mode, a->comm = comm, a->recv = recv;
+  MPI_Comm_rank(comm, &a->rank);
+  MPI_Comm_size(comm, &a->size);
+  a->msg[0] = a->msg[1] = a->msg[2] = -1;
+  a->reqs[0] = a->reqs[1] = MPI_REQUEST_NULL;
+  a->sent = a->rcvd = 0;
+  if (mode == ANNOUNCE_IBCAST && a->rank) MPI_Ibcast(a->msg, 3, MPI_INT, 0, comm, &a->reqs[1]);
+}
+
+/** Passes a->msg on: to this process's children in the tree, or to everyone from rank 0. */
+static void pass_on(announce_t *a) {
+  int rel = (a->rank - a->msg[2] + a->size) % a->size, mask = 1;
+  MPI_Request request;
+
+  if (a->mode == ANNOUNCE_IBCAST) {
+    MPI_Ibcast(a->msg, 3, MPI_INT, 0, a->comm, &a->reqs[1]);
+    a->sent += a->size - 1;
+    return;
+  }
+  // Children are rel + m for every m below rel's lowest set bit; the farthest
+  // heads the largest subtree, so it goes first
+  while (mask < a->size && !(rel & mask)) mask <<= 1;
+  for (mask >>= 1; mask; mask >>= 1) {
+    if (rel + mask >= a->size) continue;
+    MPI_Isend(a->msg, 3, MPI_INT, (a->msg[2] + rel + mask) % a->size, ANNOUNCE_TAG, a->comm, &request);
+    MPI_Request_free(&request);
+    a->sent++;
+  }
+}
+
+int announce_recv(announce_t *a, int *buf, int count, int source, MPI_Status *status) {
+  MPI_Status local;
+  int index;
+
+  if (status == MPI_STATUS_IGNORE) status = &local;
+  if (a->mode == ANNOUNCE_RING) {
+    recv_msg(a->recv, buf, count, MPI_INT, source, MPI_ANY_TAG, a->comm, status);
+    return 0;
+  }
+
+  // Into a->buf, which has room for the announcement whatever count is, or
+  // straight into buf if that is the larger (a batch, common/coalesce.h)
+  int *into = count > ANNOUNCE_MAX_MSG ? buf : a->buf, room = count > ANNOUNCE_MAX_MSG ? count : ANNOUNCE_MAX_MSG;
+  if (a->mode == ANNOUNCE_IBCAST && a->rank) {
+    // Whichever comes first; the receive stays posted if it is the broadcast
+    if (a->reqs[0] == MPI_REQUEST_NULL)
+      MPI_Irecv(into, room, MPI_INT, source, MPI_ANY_TAG, a->comm, &a->reqs[0]);
+    recv_waitany(a->recv, 2, a->reqs, &index, status);
+    if (index == 1) {
+      a->rcvd++;
+      return 1;
+    }
+  } else {
+    recv_msg(a->recv, into, room, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, a->comm, status);
+    if (status->MPI_TAG == ANNOUNCE_TAG) {
+      a->rcvd++;
+      memcpy(a->msg, into, sizeof(a->msg));
+      pass_on(a);
+      return 1;
+    }
+  }
+  if (into != buf) memcpy(buf, a->buf, (count < ANNOUNCE_MAX_MSG ? count : ANNOUNCE_MAX_MSG) * sizeof(int));
+  return 0;
+}
+
+void announce_leader(announce_t *a, int uid) {
+  announce_result(a, uid, a->rank);
+}
+
+void announce_result(announce_t *a, int uid, int rank) {
+  MPI_Request request;
+
+  if (a->mode == ANNOUNCE_RING) return;
+  if (a->mode == ANNOUNCE_IBCAST && a->rank) {
+    // a->msg is where the broadcast lands
+    a->out[0] = uid, a->out[1] = rank, a->out[2] = a->rank;
+    MPI_Isend(a->out, 3, MPI_INT, 0, ANNOUNCE_TAG, a->comm, &request);
+    MPI_Request_free(&request);
+    a->sent++;
+    return;
+  }
+  a->msg[0] = uid, a->msg[1] = rank, a->msg[2] = a->rank;
+  pass_on(a);
+}
+
+void announce_end(announce_t *a) {
+  if (a->mode != ANNOUNCE_IBCAST) return;
+  if (a->reqs[0] != MPI_REQUEST_NULL) {
+    MPI_Cancel(&a->reqs[0]);
+    MPI_Wait(&a->reqs[0], MPI_STATUS_IGNORE);
+  }
+  // Still pending at the leader, which didn't wait for it, and at rank 0
+  if (a->reqs[1] != MPI_REQUEST_NULL) {
+    MPI_Wait(&a->reqs[1], MPI_STATUS_IGNORE);
+    if (a->rank) a->rcvd++;
+  }
+}
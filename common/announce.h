@@ -0,0 +1,74 @@
+/**
+ * announce.h
+ *
+ * How hs and lcr tell everyone who won (-b). ring is the programs' own lap
+ * (TAG_IGNORE in hs, the TAG_ELECTION lap in lcr), n hops after the leader
+ * knows. The other two take O(log n) hops:
+ *   tree    the leader sends the result down a binomial tree rooted at
+ *           itself, each process passing it on to its children
+ *   ibcast  every process posts an MPI_Ibcast rooted at rank 0 before the
+ *           election starts; the leader sends the result to rank 0, which
+ *           starts the broadcast
+ * MPI_Ibcast needs a root every process agrees on up front, which the leader
+ * isn't, hence the extra hop to rank 0.
+ *
+ * The program receives through announce_recv(), which returns the next
+ * election message or says the announcement has arrived. Election messages
+ * still in flight when it does are left undelivered. It waits the way the
+ * recv_t given to announce_init() says (common/recv.h).
+ */
+
+#ifndef ANNOUNCE_H
+#define ANNOUNCE_H
+
+#include <mpi.h>
+#include "recv.h"
+
+#define ANNOUNCE_TAG 64 // above every election tag
+#define ANNOUNCE_MAX_MSG 8
+
+typedef enum { ANNOUNCE_RING, ANNOUNCE_TREE, ANNOUNCE_IBCAST } announce_mode_t;
+
+typedef struct {
+  announce_mode_t mode;
+  MPI_Comm comm;
+  int rank, size;
+  int msg[3], out[3];        // { leader uid, leader rank, sender } received and sent
+  int buf[ANNOUNCE_MAX_MSG]; // where election messages are received
+  MPI_Request reqs[2];       // that receive and the broadcast (ibcast)
+  int sent, rcvd;            // announcement messages, a broadcast counting n - 1
+  recv_t *recv;              // how announce_recv waits, NULL blocks
+} announce_t;
+
+/** Returns 0 and sets *mode if s names a mode. */
+int announce_parse(const char *s, announce_mode_t *mode);
+const char *announce_name(announce_mode_t mode);
+
+/**
+ * Before the election, on the communicator it runs on. For ibcast, posts the
+ * broadcast on every rank but 0, which joins it when it learns the leader; so
+ * no other collective on comm may come between this and announce_end().
+ * recv, if not NULL, is the receive strategy and counts its waits.
+ */
+void announce_init(announce_t *a, announce_mode_t mode, recv_t *recv, MPI_Comm comm);
+
+/**
+ * In place of the election's MPI_Recv(buf, count, MPI_INT, source, MPI_ANY_TAG).
+ * Returns 0 with an election message in buf and *status, or 1 once the
+ * announcement is here (in a->msg), after passing it on. Outside ring mode
+ * source is widened to MPI_ANY_SOURCE, as the announcement can come from
+ * anywhere. With count above ANNOUNCE_MAX_MSG the message is received
+ * straight into buf, which must then stay put until announce_end().
+ */
+int announce_recv(announce_t *a, int *buf, int count, int source, MPI_Status *status);
+
+/** The leader, once it knows; starts the announcement. Does nothing for ring. */
+void announce_leader(announce_t *a, int uid);
+
+/** Same, from any process that knows the result; the tree is rooted at it. */
+void announce_result(announce_t *a, int uid, int rank);
+
+/** After the election: completes the broadcast and drops any posted receive. */
+void announce_end(announce_t *a);
+
+#endif
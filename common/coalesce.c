@@ -0,0 +1,137 @@
+/**
+ * coalesce.c
+ *
+ * Per-link batches of election messages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fgmpi.h>
+#include "coalesce.h"
+
+#define SLOT (1 + COALESCE_MSG) // a message in a batch: tag, payload
+
+int coalesce_parse(const char *s, coalesce_t **c) {
+  int max, polls = 0;
+  char *end;
+
+  max = strtol(s, &end, 10);
+  if (*end == ':') polls = strtol(end + 1, &end, 10);
+  if (end == s || *end || max < 1 || max > COALESCE_MAX || polls < 0) return 1;
+  if (!*c && !(*c = calloc(1, sizeof(coalesce_t)))) {
+    printf("coalesce: out of memory\n");
+    exit(1);
+  }
+  (*c)->max = max, (*c)->polls = polls;
+  return 0;
+}
+
+void coalesce_init(coalesce_t *c, int left, int right, MPI_Comm comm) {
+  c->comm = comm;
+  c->links[0].dest = left, c->links[1].dest = right;
+  c->links[0].req = c->links[1].req = MPI_REQUEST_NULL;
+}
+
+static void flush_link(coalesce_t *c, coalesce_link_t *l) {
+  if (!l->n) return;
+  c->held += l->n * MPI_Wtime() - l->queued;
+  c->wire++;
+  if (l->n == 1) {
+    MPI_Isend(l->buf + 2, COALESCE_MSG, MPI_INT, l->dest, l->buf[1], c->comm, &l->req);
+  } else {
+    l->buf[0] = l->n;
+    MPI_Isend(l->buf, 1 + l->n * SLOT, MPI_INT, l->dest, COALESCE_TAG, c->comm, &l->req);
+    c->batches++;
+  }
+  l->n = 0, l->queued = 0;
+}
+
+void coalesce_send(coalesce_t *c, const int *msg, int dest, int tag, MPI_Comm comm) {
+  MPI_Request request;
+  coalesce_link_t *l;
+
+  if (!c) {
+    MPI_Isend(msg, COALESCE_MSG, MPI_INT, dest, tag, comm, &request);
+    MPI_Request_free(&request);
+    return;
+  }
+  l = dest == c->links[0].dest ? &c->links[0] : &c->links[1];
+  // The last batch may still be going out of buf
+  if (!l->n && l->req != MPI_REQUEST_NULL) MPI_Wait(&l->req, MPI_STATUS_IGNORE);
+  l->buf[1 + l->n * SLOT] = tag;
+  memcpy(&l->buf[2 + l->n * SLOT], msg, COALESCE_MSG * sizeof(int));
+  l->queued += MPI_Wtime();
+  c->msgs++;
+  if (++l->n == c->max) {
+    if (c->max > 1) c->full++;
+    flush_link(c, l);
+  }
+}
+
+void coalesce_flush(coalesce_t *c) {
+  if (!c) return;
+  flush_link(c, &c->links[0]);
+  flush_link(c, &c->links[1]);
+}
+
+int coalesce_recv(coalesce_t *c, announce_t *a, int *buf, int source, MPI_Status *status) {
+  MPI_Status local;
+  int i, flag = 0;
+
+  if (!c) return announce_recv(a, buf, COALESCE_MSG, source, status);
+  if (status == MPI_STATUS_IGNORE) status = &local;
+
+  while (c->next == c->count) {
+    // Out of input: send what is waiting, unless more comes in within the budget
+    if (c->links[0].n || c->links[1].n) {
+      for (i = 0; ; i++) {
+        MPI_Iprobe(source, MPI_ANY_TAG, c->comm, &flag, MPI_STATUS_IGNORE);
+        if (flag || i >= c->polls) break;
+        MPIX_Yield();
+      }
+      if (!flag) coalesce_flush(c);
+    }
+    if (announce_recv(a, c->in, COALESCE_INTS, source, status)) return 1;
+    if (status->MPI_TAG != COALESCE_TAG) {
+      memcpy(buf, c->in, COALESCE_MSG * sizeof(int));
+      return 0;
+    }
+    c->next = 0, c->count = c->in[0], c->src = status->MPI_SOURCE;
+  }
+
+  status->MPI_SOURCE = c->src, status->MPI_TAG = c->in[1 + c->next * SLOT];
+  memcpy(buf, &c->in[2 + c->next * SLOT], COALESCE_MSG * sizeof(int));
+  c->next++;
+  return 0;
+}
+
+void coalesce_report(const coalesce_t *c, double latency, MPI_Comm comm) {
+  int rank, size;
+
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  // Sums: { messages, sent out, batches, full batches, seconds held }
+  double sum[5] = { c->msgs, c->wire, c->batches, c->full, c->held }, tsum[5], tmax;
+  MPI_Reduce(sum, tsum, 5, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(&latency, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  if (!rank) {
+    printf("Coalesce: max=%d, polls=%d, ranks=%d, msgs=%.0f, wire=%.0f, ratio=%.2f, batches=%.0f, full=%.0f, "
+           "held_per_msg=%.9f, latency=%.6f\n", c->max, c->polls, size, tsum[0], tsum[1],
+           tsum[1] > 0 ? tsum[0] / tsum[1] : 1, tsum[2], tsum[3], tsum[0] > 0 ? tsum[4] / tsum[0] : 0, tmax);
+  }
+}
+
+void coalesce_free(coalesce_t *c) {
+  MPI_Request reqs[2];
+
+  if (!c) return;
+  // The last batches may still be going out of their bufs. Every neighbour is
+  // still in MPI and a batch is a few hundred bytes, so this doesn't wait for
+  // them to be received, which in tree and ibcast mode they may never be.
+  reqs[0] = c->links[0].req, reqs[1] = c->links[1].req;
+  MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+  free(c);
+}
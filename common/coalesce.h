@@ -0,0 +1,85 @@
+/**
+ * coalesce.h
+ *
+ * Batches hs's election messages per link (-c). A message for a neighbour
+ * waits in that link's batch, which goes out as one message when it holds
+ * the most it may (the size budget) or when the process is out of input and
+ * would otherwise wait. Out of input means nothing is there at MPI_Iprobe,
+ * tried polls more times with an MPIX_Yield in between (the time budget), so
+ * a batch gathers what one processing step sends plus whatever it has to
+ * answer that is already in. Nothing is held while the process waits, so
+ * batching can't deadlock the ring.
+ *
+ * A batch goes out under COALESCE_TAG as its message count, then the tag and
+ * payload of each message; a batch of one goes out as the message itself.
+ * coalesce_recv() unpacks a batch and hands its messages back one at a time
+ * in the order they were sent, so the program handles them as it would have
+ * one by one, and counts them the same.
+ */
+
+#ifndef COALESCE_H
+#define COALESCE_H
+
+#include <mpi.h>
+#include "announce.h"
+
+#define COALESCE_MSG 3  // ints in a message, hs's SIZE_MSG
+#define COALESCE_MAX 16 // messages in a batch at most
+#define COALESCE_INTS (1 + COALESCE_MAX * (1 + COALESCE_MSG))
+#define COALESCE_TAG 63 // a batch; above every election tag, below ANNOUNCE_TAG
+
+typedef struct {
+  int dest, n;               // neighbour, messages waiting
+  int buf[COALESCE_INTS];    // count, then tag and payload of each
+  double queued;             // when the waiting messages were sent, summed
+  MPI_Request req;           // the last batch out of buf
+} coalesce_link_t;
+
+typedef struct {
+  int max, polls;            // size and time budget
+  MPI_Comm comm;
+  coalesce_link_t links[2];  // to the left and the right neighbour
+  int in[COALESCE_INTS];     // the batch being handed back
+  int next, count, src;      // its next message, how many and where from
+  long msgs, wire, batches;  // messages sent, messages that went out, batches of more than one
+  long full;                 // batches that went out because they were full
+  double held;               // seconds messages spent in batches, summed
+} coalesce_t;
+
+/**
+ * Returns 0 and allocates *c, counters zeroed, if s is <max>[:<polls>] with
+ * max from 1 to COALESCE_MAX and polls 0 or more.
+ */
+int coalesce_parse(const char *s, coalesce_t **c);
+
+/** After MPI_Init; the program sends only to left and right. */
+void coalesce_init(coalesce_t *c, int left, int right, MPI_Comm comm);
+
+/** In place of an MPI_Isend of COALESCE_MSG ints the program doesn't wait on; c NULL sends it now. */
+void coalesce_send(coalesce_t *c, const int *msg, int dest, int tag, MPI_Comm comm);
+
+/**
+ * In place of announce_recv(a, buf, COALESCE_MSG, source, status), which it
+ * returns the result of; sends what is waiting first if it has to wait. c
+ * NULL is announce_recv().
+ */
+int coalesce_recv(coalesce_t *c, announce_t *a, int *buf, int source, MPI_Status *status);
+
+/**
+ * Sends everything waiting; after the election loop, before anything that lets
+ * a neighbour leave. c NULL does nothing.
+ */
+void coalesce_flush(coalesce_t *c);
+
+/**
+ * Collective over comm, after the election. latency is this rank's time in
+ * it. Rank 0 prints the budgets, the messages sent and those that went out
+ * summed over the ranks, their ratio, the batches that filled up, the mean
+ * time a message waited in a batch and the longest latency.
+ */
+void coalesce_report(const coalesce_t *c, double latency, MPI_Comm comm);
+
+/** Waits for the last batches to go out of their buffers, then frees c; before MPI_Finalize. */
+void coalesce_free(coalesce_t *c);
+
+#endif
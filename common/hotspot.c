@@ -0,0 +1,167 @@
+/**
+ * hotspot.c
+ *
+ * Messages and idle time per OS process and per node.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fgmpi.h>
+#include "hotspot.h"
+
+#define TAG_RANK 1    // a rank's record, to the start rank of its OS process
+#define TAG_SEGMENT 2 // an OS process's record, to rank 0
+
+// A rank's or an OS process's numbers, sent as bytes between processes
+typedef struct {
+  double first, ranks;
+  double sent, rcvd, tags[HOTSPOT_TAGS];
+  double wall, busy; // longest election time of a rank; summed time not waiting
+  char node[HOTSPOT_NODE];
+} segment_t;
+
+typedef struct {
+  const char *node;
+  double procs, ranks, msgs, busy, idle;
+} node_t;
+
+void hotspot_recv(hotspot_t *h, int tag) {
+  if (tag >= 0 && tag < HOTSPOT_TAGS) h->rcvd[tag]++;
+}
+
+static double msgs(const segment_t *s) {
+  return s->sent + s->rcvd;
+}
+
+static void merge(segment_t *into, const segment_t *s) {
+  int t;
+
+  into->ranks += s->ranks, into->sent += s->sent, into->rcvd += s->rcvd;
+  for (t = 0; t < HOTSPOT_TAGS; t++) into->tags[t] += s->tags[t];
+  into->busy += s->busy;
+  if (s->wall > into->wall) into->wall = s->wall;
+  if (s->first < into->first) into->first = s->first;
+}
+
+// Busiest first
+static int segments_by_msgs(const void *a, const void *b) {
+  double x = msgs(a), y = msgs(b);
+  return (x < y) - (x > y);
+}
+
+static int nodes_by_msgs(const void *a, const void *b) {
+  double x = ((const node_t *) a)->msgs, y = ((const node_t *) b)->msgs;
+  return (x < y) - (x > y);
+}
+
+static double ratio(double max, double mean) {
+  return mean > 0 ? max / mean : 1;
+}
+
+/** Rank 0: the summary, the busiest nodes and the busiest segments. */
+static void print_report(segment_t *segs, int procs, int size, double rank_sum, double rank_max,
+                         const char *const tag_names[HOTSPOT_TAGS]) {
+  node_t *nodes = calloc(procs, sizeof(node_t));
+  double os_sum = 0, os_max = 0, idle_sum = 0, idle_max = 0, node_max = 0;
+  int n = 0, i, j, t;
+
+  if (!nodes) {
+    printf("hotspot: out of memory\n");
+    return;
+  }
+  for (i = 0; i < procs; i++) {
+    segment_t *s = &segs[i];
+    double idle = s->wall > 0 ? (s->wall - s->busy) / s->wall : 0;
+
+    os_sum += msgs(s), idle_sum += idle;
+    if (msgs(s) > os_max) os_max = msgs(s);
+    if (idle > idle_max) idle_max = idle;
+    for (j = 0; j < n && strcmp(nodes[j].node, s->node); j++);
+    if (j == n) nodes[n++].node = s->node;
+    nodes[j].procs++, nodes[j].ranks += s->ranks, nodes[j].msgs += msgs(s);
+    nodes[j].busy += s->busy, nodes[j].idle += s->wall - s->busy;
+  }
+  for (j = 0; j < n; j++) {
+    if (nodes[j].msgs > node_max) node_max = nodes[j].msgs;
+  }
+
+  printf("Hotspot: ranks=%d, os_procs=%d, nodes=%d, rank_msgs=%.1f (max %.0f, imbalance %.2f), "
+         "os_msgs=%.1f (max %.0f, imbalance %.2f), node_msgs=%.1f (max %.0f, imbalance %.2f), "
+         "idle=%.1f%% (max %.1f%%)\n", size, procs, n, rank_sum / size, rank_max, ratio(rank_max, rank_sum / size),
+         os_sum / procs, os_max, ratio(os_max, os_sum / procs), os_sum / n, node_max, ratio(node_max, os_sum / n),
+         100 * idle_sum / procs, 100 * idle_max);
+
+  // The nodes first: their names point into segs, which is sorted next
+  qsort(nodes, n, sizeof(node_t), nodes_by_msgs);
+  for (j = 0; j < n && j < HOTSPOT_TOP; j++) {
+    printf("Hotspot node: node=%s, os_procs=%.0f, ranks=%.0f, msgs=%.0f, busy=%.6f, idle=%.6f\n", nodes[j].node,
+           nodes[j].procs, nodes[j].ranks, nodes[j].msgs, nodes[j].busy, nodes[j].idle);
+  }
+  free(nodes);
+
+  qsort(segs, procs, sizeof(segment_t), segments_by_msgs);
+  for (i = 0; i < procs && i < HOTSPOT_TOP; i++) {
+    segment_t *s = &segs[i];
+    printf("Hotspot segment: ranks=%.0f-%.0f, node=%s, msgs=%.0f, sent=%.0f, rcvd=%.0f", s->first,
+           s->first + s->ranks - 1, s->node, msgs(s), s->sent, s->rcvd);
+    for (t = 0; t < HOTSPOT_TAGS; t++) {
+      if (tag_names[t]) printf(", rcvd_%s=%.0f", tag_names[t], s->tags[t]);
+    }
+    printf(", busy=%.6f, idle=%.6f (%.1f%%)\n", s->busy, s->wall - s->busy,
+           s->wall > 0 ? 100 * (s->wall - s->busy) / s->wall : 0);
+  }
+}
+
+void hotspot_report(const hotspot_t *h, long sent, long rcvd, double elapsed, double waited,
+                    const char *const tag_names[HOTSPOT_TAGS], MPI_Comm comm) {
+  MPI_Comm c;
+  segment_t mine, other;
+  int rank, size, start, nfg, i, t;
+
+  // A private duplicate, so the records can't match anything of the program's
+  MPI_Comm_dup(comm, &c);
+  MPI_Comm_rank(c, &rank);
+  MPI_Comm_size(c, &size);
+  MPIX_Get_collocated_startrank(&start);
+  MPIX_Get_collocated_size(&nfg);
+
+  memset(&mine, 0, sizeof(mine));
+  mine.first = rank, mine.ranks = 1, mine.sent = sent, mine.rcvd = rcvd;
+  for (t = 0; t < HOTSPOT_TAGS; t++) mine.tags[t] = h->rcvd[t];
+  mine.wall = elapsed, mine.busy = elapsed - waited;
+
+  double m = sent + rcvd, rank_sum, rank_max, procs = rank == start, total_procs;
+  MPI_Reduce(&m, &rank_sum, 1, MPI_DOUBLE, MPI_SUM, 0, c);
+  MPI_Reduce(&m, &rank_max, 1, MPI_DOUBLE, MPI_MAX, 0, c);
+  MPI_Reduce(&procs, &total_procs, 1, MPI_DOUBLE, MPI_SUM, 0, c);
+
+  // Each OS process's start rank adds up its co-located ranks and passes the total to rank 0
+  if (rank != start) {
+    MPI_Send(&mine, sizeof(mine), MPI_CHAR, start, TAG_RANK, c);
+  } else {
+    for (i = 1; i < nfg; i++) {
+      MPI_Recv(&other, sizeof(other), MPI_CHAR, MPI_ANY_SOURCE, TAG_RANK, c, MPI_STATUS_IGNORE);
+      merge(&mine, &other);
+    }
+    if (mine.busy > mine.wall) mine.busy = mine.wall;
+    gethostname(mine.node, HOTSPOT_NODE - 1);
+    if (rank) MPI_Send(&mine, sizeof(mine), MPI_CHAR, 0, TAG_SEGMENT, c);
+  }
+
+  if (!rank) {
+    int np = (int) total_procs;
+    segment_t *segs = malloc(np * sizeof(segment_t));
+    if (!segs) {
+      printf("hotspot: out of memory\n");
+      exit(1);
+    }
+    segs[0] = mine;
+    for (i = 1; i < np; i++)
+      MPI_Recv(&segs[i], sizeof(segment_t), MPI_CHAR, MPI_ANY_SOURCE, TAG_SEGMENT, c, MPI_STATUS_IGNORE);
+    print_report(segs, np, size, rank_sum, rank_max, tag_names);
+    free(segs);
+  }
+  MPI_Comm_free(&c);
+}
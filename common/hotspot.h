@@ -0,0 +1,43 @@
+/**
+ * hotspot.h
+ *
+ * Where an election's traffic and waiting land (-p, hs and lcr). Every rank
+ * counts the messages it received by tag; at the end its sent and received
+ * totals, its time in the election and its time waiting in receives (recv.h)
+ * are added up per OS process, which under FG-MPI hosts a segment of -nfg
+ * consecutive ranks of the ring, and per node. Rank 0 prints
+ *   - messages per rank, per OS process and per node: the mean, the largest
+ *     and their ratio, the imbalance (1 is even)
+ *   - the HOTSPOT_TOP busiest nodes
+ *   - the HOTSPOT_TOP busiest segments, with their node, messages by tag and
+ *     how long their OS process was busy and idle
+ * An OS process runs one co-located rank at a time, so it was busy for the
+ * sum of its ranks' election time less their waits, at most its longest
+ * rank's election time, and idle for the rest of that.
+ */
+
+#ifndef HOTSPOT_H
+#define HOTSPOT_H
+
+#include <mpi.h>
+
+#define HOTSPOT_TAGS 8
+#define HOTSPOT_TOP 5
+#define HOTSPOT_NODE 64
+
+typedef struct {
+  long rcvd[HOTSPOT_TAGS]; // election messages received, by tag
+} hotspot_t;
+
+/** Counts a received message; tags from HOTSPOT_TAGS up aren't kept apart. */
+void hotspot_recv(hotspot_t *h, int tag);
+
+/**
+ * Collective over comm. sent and rcvd are this rank's totals, elapsed its
+ * time in the election and waited the part of it spent in receives.
+ * tag_names[tag] names the tags to show, NULL for the rest.
+ */
+void hotspot_report(const hotspot_t *h, long sent, long rcvd, double elapsed, double waited,
+                    const char *const tag_names[HOTSPOT_TAGS], MPI_Comm comm);
+
+#endif
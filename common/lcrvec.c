@@ -0,0 +1,294 @@
+/**
+ * lcrvec.c
+ *
+ * Vectorized synchronous LCR rounds. See lcrvec.h.
+ *
+ * A process's state is lcr.c's process_state with a done bit on top:
+ * INIT, NONINIT or LEADER while it still receives, and the done bit once it
+ * has left its forwarding loop (done processes drop whatever arrives, which
+ * lcr.c never lets happen). Per process and round, with (x, g) the message:
+ *
+ *   INIT,    g == ELECTION or x > max_so_far  ->  NONINIT, forward      (lose)
+ *   INIT,    x == uid                         ->  LEADER, send ELECTION (win)
+ *   INIT,    otherwise                        ->  swallow
+ *   NONINIT, g == ELECTION                    ->  forward, done         (fin)
+ *   LEADER,  x == uid and g == ELECTION       ->  done                  (back)
+ *   NONINIT or LEADER, otherwise              ->  forward
+ *
+ * Process i's output lands in slot i+1 of the other buffer, so a vector of
+ * outputs is one unaligned store one lane to the right, and the last
+ * process's output is slot len, handed to the caller.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lcrvec.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LCRVEC_X86 1
+#include <immintrin.h>
+#endif
+
+#define NONINIT 0
+#define INIT 1
+#define LEADER 2
+#define DONE 4
+
+static const char *isa_names[] = { "auto", "scalar", "avx2", "avx512" };
+
+/**
+ * Processes [from, to) of the current round with plain C. Returns how many
+ * messages they sent.
+ */
+static long long round_scalar(lcrvec_t *v, int from, int to, int *cv, int *ct, int *nv, int *nt) {
+  long long sent = 0;
+  int i;
+
+  for (i = from; i < to; i++) {
+    int x = cv[i], g = ct[i], st = v->state[i], ov = 0, ot = 0;
+
+    if (g && !(st & DONE)) {
+      v->rcvd++;
+      if (st == INIT) {
+        if (g == LCRVEC_ELECTION || x > v->max_so_far[i]) {
+          v->max_so_far[i] = x, st = NONINIT, ov = x, ot = g;
+        } else if (x == v->uid[i]) {
+          st = LEADER, ov = x, ot = LCRVEC_ELECTION;
+          v->leader = i;
+        }
+      } else if (st == NONINIT) {
+        ov = x, ot = g;
+        if (g == LCRVEC_ELECTION) {
+          if (x > v->max_so_far[i]) v->max_so_far[i] = x;
+          st |= DONE, v->done++;
+        }
+      } else if (x == v->uid[i] && g == LCRVEC_ELECTION) {
+        st |= DONE, v->done++;
+      } else {
+        ov = x, ot = g;
+      }
+      v->state[i] = st;
+    }
+    nv[i+1] = ov, nt[i+1] = ot;
+    cv[i] = ct[i] = 0;
+    sent += ot != 0;
+  }
+
+  return sent;
+}
+
+#ifdef LCRVEC_X86
+
+__attribute__((target("avx2")))
+static long long round_avx2(lcrvec_t *v, int from, int to, int *cv, int *ct, int *nv, int *nt) {
+  const __m256i zero = _mm256_setzero_si256(), ones = _mm256_set1_epi32(-1);
+  const __m256i election = _mm256_set1_epi32(LCRVEC_ELECTION), done = _mm256_set1_epi32(DONE);
+  const __m256i init = _mm256_set1_epi32(INIT), noninit = _mm256_set1_epi32(NONINIT);
+  const __m256i leader = _mm256_set1_epi32(LEADER);
+  long long sent = 0;
+  int i;
+
+  for (i = from; i < to; i += 8) {
+    __m256i x = _mm256_loadu_si256((__m256i *) (cv + i)), g = _mm256_loadu_si256((__m256i *) (ct + i));
+    __m256i st = _mm256_load_si256((__m256i *) (v->state + i));
+    __m256i mx = _mm256_load_si256((__m256i *) (v->max_so_far + i));
+    __m256i u = _mm256_load_si256((__m256i *) (v->uid + i));
+
+    __m256i live = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(g, zero),
+                                                       _mm256_cmpeq_epi32(_mm256_and_si256(st, done), done)), ones);
+    __m256i is_el = _mm256_cmpeq_epi32(g, election), eq = _mm256_cmpeq_epi32(x, u);
+    __m256i beats = _mm256_or_si256(is_el, _mm256_cmpgt_epi32(x, mx));
+    __m256i m_init = _mm256_and_si256(live, _mm256_cmpeq_epi32(st, init));
+    __m256i m_non = _mm256_and_si256(live, _mm256_cmpeq_epi32(st, noninit));
+    __m256i m_lead = _mm256_and_si256(live, _mm256_cmpeq_epi32(st, leader));
+
+    __m256i lose = _mm256_and_si256(m_init, beats);
+    __m256i win = _mm256_andnot_si256(beats, _mm256_and_si256(m_init, eq));
+    __m256i fin = _mm256_and_si256(m_non, is_el);
+    __m256i back = _mm256_and_si256(m_lead, _mm256_and_si256(eq, is_el));
+    __m256i fwd = _mm256_or_si256(_mm256_or_si256(lose, m_non), _mm256_andnot_si256(back, m_lead));
+    __m256i leave = _mm256_or_si256(fin, back);
+
+    st = _mm256_blendv_epi8(st, noninit, lose);
+    st = _mm256_blendv_epi8(st, leader, win);
+    st = _mm256_or_si256(st, _mm256_and_si256(leave, done));
+    mx = _mm256_blendv_epi8(mx, x, lose);
+    mx = _mm256_blendv_epi8(mx, _mm256_max_epi32(mx, x), fin);
+    _mm256_store_si256((__m256i *) (v->state + i), st);
+    _mm256_store_si256((__m256i *) (v->max_so_far + i), mx);
+
+    __m256i ov = _mm256_or_si256(_mm256_and_si256(fwd, x), _mm256_and_si256(win, u));
+    __m256i ot = _mm256_or_si256(_mm256_and_si256(fwd, g), _mm256_and_si256(win, election));
+    _mm256_storeu_si256((__m256i *) (nv + i + 1), ov);
+    _mm256_storeu_si256((__m256i *) (nt + i + 1), ot);
+    _mm256_storeu_si256((__m256i *) (cv + i), zero);
+    _mm256_storeu_si256((__m256i *) (ct + i), zero);
+
+    int m_win = _mm256_movemask_ps(_mm256_castsi256_ps(win));
+    v->rcvd += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(live)));
+    v->done += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(leave)));
+    sent += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(fwd, win))));
+    if (m_win) v->leader = i + __builtin_ctz(m_win);
+  }
+
+  return sent;
+}
+
+__attribute__((target("avx512f")))
+static long long round_avx512(lcrvec_t *v, int from, int to, int *cv, int *ct, int *nv, int *nt) {
+  const __m512i zero = _mm512_setzero_si512(), election = _mm512_set1_epi32(LCRVEC_ELECTION);
+  const __m512i done = _mm512_set1_epi32(DONE), init = _mm512_set1_epi32(INIT);
+  const __m512i noninit = _mm512_set1_epi32(NONINIT), leader = _mm512_set1_epi32(LEADER);
+  long long sent = 0;
+  int i;
+
+  for (i = from; i < to; i += 16) {
+    __m512i x = _mm512_loadu_si512(cv + i), g = _mm512_loadu_si512(ct + i);
+    __m512i st = _mm512_load_si512(v->state + i), mx = _mm512_load_si512(v->max_so_far + i);
+    __m512i u = _mm512_load_si512(v->uid + i);
+
+    __mmask16 live = _mm512_test_epi32_mask(g, g) & _mm512_testn_epi32_mask(st, done);
+    __mmask16 is_el = _mm512_cmpeq_epi32_mask(g, election), eq = _mm512_cmpeq_epi32_mask(x, u);
+    __mmask16 beats = is_el | _mm512_cmpgt_epi32_mask(x, mx);
+    __mmask16 m_init = live & _mm512_cmpeq_epi32_mask(st, init);
+    __mmask16 m_non = live & _mm512_cmpeq_epi32_mask(st, noninit);
+    __mmask16 m_lead = live & _mm512_cmpeq_epi32_mask(st, leader);
+
+    __mmask16 lose = m_init & beats, win = m_init & eq & ~beats;
+    __mmask16 fin = m_non & is_el, back = m_lead & eq & is_el;
+    __mmask16 fwd = lose | m_non | (m_lead & ~back), leave = fin | back;
+
+    st = _mm512_mask_mov_epi32(st, lose, noninit);
+    st = _mm512_mask_mov_epi32(st, win, leader);
+    st = _mm512_mask_or_epi32(st, leave, st, done);
+    mx = _mm512_mask_mov_epi32(mx, lose, x);
+    mx = _mm512_mask_max_epi32(mx, fin, mx, x);
+    _mm512_store_si512(v->state + i, st);
+    _mm512_store_si512(v->max_so_far + i, mx);
+
+    _mm512_storeu_si512(nv + i + 1, _mm512_mask_mov_epi32(_mm512_maskz_mov_epi32(fwd, x), win, u));
+    _mm512_storeu_si512(nt + i + 1, _mm512_mask_mov_epi32(_mm512_maskz_mov_epi32(fwd, g), win, election));
+    _mm512_storeu_si512(cv + i, zero);
+    _mm512_storeu_si512(ct + i, zero);
+
+    v->rcvd += __builtin_popcount(live);
+    v->done += __builtin_popcount(leave);
+    sent += __builtin_popcount(fwd | win);
+    if (win) v->leader = i + __builtin_ctz(win);
+  }
+
+  return sent;
+}
+
+#endif
+
+static lcrvec_isa_t best_isa(void) {
+#ifdef LCRVEC_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return LCRVEC_AVX512;
+  if (__builtin_cpu_supports("avx2")) return LCRVEC_AVX2;
+#endif
+  return LCRVEC_SCALAR;
+}
+
+static int *slots(size_t n) {
+  int *p = aligned_alloc(64, n * sizeof(int));
+  if (p) memset(p, 0, n * sizeof(int));
+  return p;
+}
+
+int lcrvec_init(lcrvec_t *v, int len, const int *uids, lcrvec_isa_t isa, int *out_val, int *out_tag) {
+  lcrvec_isa_t best = best_isa();
+  size_t n;
+  int i, b;
+
+  memset(v, 0, sizeof(*v));
+  v->len = len, v->leader = -1;
+  v->nblocks = (len + LCRVEC_BLOCK - 1) / LCRVEC_BLOCK;
+  v->isa = (isa == LCRVEC_AUTO || isa > best) ? best : isa;
+
+  // One spare block, for slot len and the last vector's store one lane over
+  n = (size_t) (v->nblocks + 1) * LCRVEC_BLOCK;
+  v->uid = slots(n), v->max_so_far = slots(n), v->state = slots(n);
+  v->val[0] = slots(n), v->val[1] = slots(n), v->tag[0] = slots(n), v->tag[1] = slots(n);
+  v->blocks[0] = malloc(v->nblocks * sizeof(int)), v->blocks[1] = malloc(v->nblocks * sizeof(int));
+  v->listed[0] = calloc(v->nblocks, 1), v->listed[1] = calloc(v->nblocks, 1);
+  if (!v->uid || !v->max_so_far || !v->state || !v->val[0] || !v->val[1] || !v->tag[0] || !v->tag[1] ||
+      !v->blocks[0] || !v->blocks[1] || !v->listed[0] || !v->listed[1]) {
+    lcrvec_free(v);
+    return -1;
+  }
+
+  // Round 0: every process sends its uid to the right
+  for (i = 0; i < (int) n; i++) v->state[i] = i < len ? INIT : (NONINIT | DONE);
+  for (i = 0; i < len; i++) {
+    v->uid[i] = v->max_so_far[i] = uids[i];
+    if (i + 1 < len) v->val[0][i+1] = uids[i], v->tag[0][i+1] = LCRVEC_PHASE1;
+  }
+  for (b = 0; b < v->nblocks; b++) v->blocks[0][b] = b, v->listed[0][b] = 1;
+  v->nblocks_active[0] = v->nblocks;
+  *out_val = uids[len-1], *out_tag = LCRVEC_PHASE1;
+  v->sent = len;
+
+  return 0;
+}
+
+static void list_block(lcrvec_t *v, int side, int b) {
+  if (b >= v->nblocks || v->listed[side][b]) return;
+  v->listed[side][b] = 1;
+  v->blocks[side][v->nblocks_active[side]++] = b;
+}
+
+long long lcrvec_round(lcrvec_t *v, int in_val, int in_tag, int *out_val, int *out_tag) {
+  int c = v->cur, n = c ^ 1;
+  int *cv = v->val[c], *ct = v->tag[c], *nv = v->val[n], *nt = v->tag[n];
+  long long sent = 0;
+  int j;
+
+  if (in_tag) cv[0] = in_val, ct[0] = in_tag, list_block(v, c, 0);
+
+  // Blocks write disjoint slots of the next round, so their order doesn't matter
+  for (j = 0; j < v->nblocks_active[c]; j++) {
+    int b = v->blocks[c][j], from = b * LCRVEC_BLOCK, to = from + LCRVEC_BLOCK;
+    long long s;
+    v->listed[c][b] = 0;
+    switch (v->isa) {
+#ifdef LCRVEC_X86
+      case LCRVEC_AVX512: s = round_avx512(v, from, to, cv, ct, nv, nt); break;
+      case LCRVEC_AVX2: s = round_avx2(v, from, to, cv, ct, nv, nt); break;
+#endif
+      default: s = round_scalar(v, from, to, cv, ct, nv, nt); break;
+    }
+    if (s) list_block(v, n, b), list_block(v, n, b + 1);
+    sent += s;
+  }
+  v->nblocks_active[c] = 0;
+
+  *out_val = nv[v->len], *out_tag = nt[v->len];
+  nv[v->len] = nt[v->len] = 0;
+  v->sent += sent;
+  v->cur ^= 1;
+
+  return sent;
+}
+
+void lcrvec_free(lcrvec_t *v) {
+  free(v->uid), free(v->max_so_far), free(v->state);
+  free(v->val[0]), free(v->val[1]), free(v->tag[0]), free(v->tag[1]);
+  free(v->blocks[0]), free(v->blocks[1]), free(v->listed[0]), free(v->listed[1]);
+  memset(v, 0, sizeof(*v));
+}
+
+const char *lcrvec_isa_name(lcrvec_isa_t isa) {
+  return isa_names[isa];
+}
+
+int lcrvec_isa_parse(const char *str, lcrvec_isa_t *isa) {
+  int i;
+  for (i = LCRVEC_AUTO; i <= LCRVEC_AVX512; i++)
+    if (!strcmp(str, isa_names[i])) {
+      *isa = (lcrvec_isa_t) i;
+      return 0;
+    }
+  return -1;
+}
@@ -0,0 +1,67 @@
+/**
+ * lcrvec.h
+ *
+ * Round-synchronous LCR on a contiguous run of ring processes, vectorized.
+ *
+ * In a synchronous round every process gets at most one message from its left
+ * neighbour, so lcr.c's receive loop becomes a pure function of (message,
+ * state) per process and a round is the same few compares and blends across
+ * the whole run. uid, max_so_far and state are kept as separate arrays with
+ * one message slot per process, and a round handles 16 (AVX-512), 8 (AVX2) or
+ * 1 (scalar) processes per step, counting messages with popcounts over the
+ * compare masks. Processes are grouped in blocks of LCRVEC_BLOCK, and a round
+ * only visits the blocks on its list of blocks with a message, so late rounds
+ * with a handful of probes left cost little.
+ *
+ * Every process follows lcr.c branch for branch, so leader and counts equal
+ * lcr.c's, which do not depend on timing. The run can be the whole ring
+ * (feed the message out of the last process back into the first) or one
+ * segment of a larger ring, with the neighbouring segment's last process on
+ * the other end of that one message.
+ */
+
+#ifndef LCRVEC_H
+#define LCRVEC_H
+
+#define LCRVEC_BLOCK 64
+
+// Message tags in a slot; 0 is an empty slot
+#define LCRVEC_PHASE1 2
+#define LCRVEC_ELECTION 3
+
+typedef enum { LCRVEC_AUTO, LCRVEC_SCALAR, LCRVEC_AVX2, LCRVEC_AVX512 } lcrvec_isa_t;
+
+typedef struct {
+  int len, nblocks;
+  lcrvec_isa_t isa;
+  int *uid, *max_so_far, *state;
+  int *val[2], *tag[2];          // slot i: the message arriving at process i; [cur], [cur ^ 1]
+  int *blocks[2], nblocks_active[2]; // blocks with a message in [cur], [cur ^ 1], unordered
+  unsigned char *listed[2];      // whether a block is in blocks[]
+  int cur;
+  unsigned long long rcvd, sent; // lnum_recv and lnum_sent summed over the run
+  int leader;                    // offset of the process that became leader, or -1
+  int done;                      // processes that have left the election
+} lcrvec_t;
+
+/**
+ * Sets up len processes with the given uids and runs round 0, in which every
+ * process sends its uid; the last one's is returned in *out_val, *out_tag.
+ * isa LCRVEC_AUTO picks the widest the CPU has. Returns 0, or -1 if out of memory.
+ */
+int lcrvec_init(lcrvec_t *v, int len, const int *uids, lcrvec_isa_t isa, int *out_val, int *out_tag);
+
+/**
+ * One round. (in_val, in_tag) is what the left neighbour sent in the previous
+ * round (in_tag 0 for nothing); what the last process sends this round comes
+ * back in *out_val, *out_tag. Returns the number of messages sent this round.
+ */
+long long lcrvec_round(lcrvec_t *v, int in_val, int in_tag, int *out_val, int *out_tag);
+
+void lcrvec_free(lcrvec_t *v);
+
+/** "scalar", "avx2" or "avx512"; lcrvec_isa_parse returns -1 for anything else. */
+const char *lcrvec_isa_name(lcrvec_isa_t isa);
+int lcrvec_isa_parse(const char *str, lcrvec_isa_t *isa);
+
+#endif
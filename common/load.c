@@ -0,0 +1,28 @@
+/**
+ * load.c
+ *
+ * Leader against best capacity for load-aware uids.
+ */
+
+#include <stdio.h>
+#include "load.h"
+
+void load_report(const uid_spec_t *spec, int uid, int leader_uid, int size, MPI_Comm comm) {
+  int rank;
+
+  if (spec->dist != UID_LOAD) return;
+
+  // Time one more uid, as the program made its own before any clock was set
+  MPI_Comm_rank(comm, &rank);
+  double t = MPI_Wtime();
+  uid_generate(spec, rank % size, size, 0);
+  double in[2] = { uid, MPI_Wtime() - t }, out[2];
+  MPI_Allreduce(in, out, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+  if (leader_uid < 0) return;
+
+  int best = (int) out[0];
+  double leader = uid_capacity(leader_uid, size), top = uid_capacity(best, size);
+  printf("Load: source=%s, leader_capacity=%.4f, best_capacity=%.4f, best_rank=%d, gap=%.4f, uid_seconds=%.6f\n",
+         uid_name(spec) + 5, leader, top, best % size, top - leader, out[1]);
+}
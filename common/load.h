@@ -0,0 +1,25 @@
+/**
+ * load.h
+ *
+ * Report for load-aware uids (-u load:SRC, see uid.h). The largest uid is the
+ * largest capacity, so the leader should be the least loaded process; the
+ * report says how far it is from the best in the job (non-zero when not
+ * every process takes part, as in hs-random and lcr-random) and what making
+ * the uids cost. The message cost shows in tsent against a run with the
+ * program's usual uids.
+ */
+
+#ifndef LOAD_H
+#define LOAD_H
+
+#include <mpi.h>
+#include "uid.h"
+
+/**
+ * Collective over comm for load uids; does nothing otherwise. uid is the
+ * largest this process generated, size the ring size it was generated for.
+ * The process with leader_uid >= 0, the elected uid, prints the report.
+ */
+void load_report(const uid_spec_t *spec, int uid, int leader_uid, int size, MPI_Comm comm);
+
+#endif
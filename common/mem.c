@@ -0,0 +1,63 @@
+/**
+ * mem.c
+ *
+ * Stack painting, the resident set size from /proc and the -m report.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fgmpi.h>
+#include "mem.h"
+
+#define PATTERN 0xA5
+
+__attribute__((noinline)) size_t mem_stack_mark(int paint, size_t n, const void *base) {
+  unsigned char buf[n];
+  volatile unsigned char *p = buf;
+  size_t i;
+
+  // Hide where p points, so reading what an earlier call left there is kept
+  __asm__ volatile("" : "+r" (p));
+  if (paint) {
+    for (i = 0; i < n; i++) p[i] = PATTERN;
+    return 0;
+  }
+  // The stack grows down, so whatever was reached was written from the top
+  for (i = 0; i < n && p[i] == PATTERN; i++);
+  return n - i + ((const char *) base - (const char *) (p + n));
+}
+
+long mem_rss_kb(void) {
+  char line[128];
+  long kb = -1;
+  FILE *f = fopen("/proc/self/status", "r");
+
+  if (!f) return -1;
+  while (fgets(line, sizeof(line), f))
+    if (!strncmp(line, "VmRSS:", 6)) {
+      sscanf(line + 6, "%ld", &kb);
+      break;
+    }
+  fclose(f);
+  return kb;
+}
+
+void mem_report(size_t stack, size_t state, MPI_Comm comm) {
+  int rank, size, start;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  MPIX_Get_collocated_startrank(&start);
+
+  // Sums: { OS processes, rss, stack }; maxima: { rss, stack, state }
+  long rss = rank == start ? mem_rss_kb() : 0;
+  double sum[3] = { rank == start, rss, stack }, tsum[3];
+  long long max[3] = { rss, (long long) stack, (long long) state }, tmax[3];
+  MPI_Reduce(sum, tsum, 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(max, tmax, 3, MPI_LONG_LONG, MPI_MAX, 0, comm);
+
+  if (!rank) {
+    printf("Memory: ranks=%d, os_procs=%.0f, rss_kb=%.0f (max %lld), rss_kb_per_rank=%.1f, stack=%.0f (max %lld), "
+           "state_bytes=%lld, est_bytes_per_rank=%lld\n", size, tsum[0], tsum[1], tmax[0], tsum[1] / size,
+           tsum[2] / size, tmax[1], tmax[2], tmax[1] + tmax[2]);
+  }
+}
@@ -0,0 +1,39 @@
+/**
+ * mem.h
+ *
+ * Memory measurements for co-located FG-MPI processes, which share one
+ * address space and so one resident set size.
+ *
+ * Stack use is found by painting: mem_stack_mark(1, n, base) fills the n
+ * bytes below the caller's frame with a pattern, and mem_stack_mark(0, n,
+ * base), called later from the same function, returns how much of it has
+ * been written over since, i.e. the deepest the calls in between went, plus
+ * the caller's own frame down from base, the address of one of its locals.
+ * n must fit in the stack (FG-MPI gives every co-located process the same
+ * fixed size).
+ */
+
+#ifndef MEM_H
+#define MEM_H
+
+#include <stddef.h>
+#include <mpi.h>
+
+#define MEM_STACK_PAINT 16384
+
+/** Paints (paint set) or measures the n bytes below the caller. Returns bytes used. */
+size_t mem_stack_mark(int paint, size_t n, const void *base);
+
+/** VmRSS of this OS process in kB, or -1 if /proc can't say. */
+long mem_rss_kb(void);
+
+/**
+ * Collective over comm, for -m. stack is this rank's painted stack use and
+ * state the bytes of its election state (0 if it keeps none in one place). Rank 0 prints the resident memory of
+ * the OS processes (total, largest and per co-located rank), the mean and
+ * largest stack, and an estimate of what each co-located rank costs on top
+ * of its OS process: the state plus the largest stack.
+ */
+void mem_report(size_t stack, size_t state, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,63 @@
+/**
+ * options.c
+ *
+ * Shared command-line flags for the election programs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "options.h"
+
+int opts_parse(int argc, char *argv[], run_opts_t *opts, char *args[OPTS_MAX_ARGS + 1]) {
+  return opts_parse_with(argc, argv, opts, args, 0);
+}
+
+int opts_parse_with(int argc, char *argv[], run_opts_t *opts, char *args[OPTS_MAX_ARGS + 1], int extra) {
+  int i, n = 0;
+
+  opts->stats_path = NULL;
+  memset(&opts->uids, 0, sizeof(opts->uids));
+  opts->seed = -1;
+  opts->timing = 0;
+  opts->memory = 0;
+  opts->placement = 0;
+
+  for (i = 0; i < argc; i++) {
+    if (i > 0 && !strcmp(argv[i], "-t")) {
+      opts->timing = 1;
+      continue;
+    }
+    if (i > 0 && (extra & OPTS_MEMORY) && !strcmp(argv[i], "-m")) {
+      opts->memory = 1;
+      continue;
+    }
+    if (i > 0 && (extra & OPTS_PLACEMENT) && !strcmp(argv[i], "-p")) {
+      opts->placement = 1;
+      continue;
+    }
+    if (i > 0 && argv[i][0] == '-' && argv[i][1] && !argv[i][2] && strchr("ous", argv[i][1])) {
+      if (i + 1 >= argc) return -1;
+      const char *val = argv[++i];
+      switch (argv[i-1][1]) {
+        case 'o': opts->stats_path = val; break;
+        case 'u': if (uid_parse(val, &opts->uids)) return -1; break;
+        case 's': opts->seed = atol(val); if (opts->seed < 0) return -1; break;
+      }
+      continue;
+    }
+    if (n == OPTS_MAX_ARGS) return -1;
+    args[n++] = argv[i];
+  }
+  args[n] = NULL;
+
+  // perm and clustered need the same key on every rank, so never the clock
+  opts->uids.seed = opts->seed < 0 ? 0 : (unsigned) opts->seed;
+
+  return n;
+}
+
+void opts_srand(const run_opts_t *opts, int rank) {
+  if (opts->seed < 0) srand(time(NULL) + rank);
+  else srand(opts->seed + rank);
+}
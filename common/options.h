@@ -0,0 +1,52 @@
+/**
+ * options.h
+ *
+ * Flags shared by all of the election programs. They are pulled out of argv
+ * before each program does its own [ -v ] <Process number> parsing, so the
+ * per-program usage checks stay as they are.
+ *
+ * argv is shared by every FG-MPI process co-located in one OS process, so it
+ * is never modified; the remaining arguments are copied into args[] instead.
+ *
+ * A few flags only mean something to some programs. opts_parse_with() pulls
+ * out those the program asks for and leaves the rest in args[], where the
+ * program's own parsing rejects them or takes them as its own.
+ */
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "uid.h"
+
+#define OPTS_MAX_ARGS 16
+#define OPTS_USAGE "[ -o <stats file> ] [ -u <uid distribution> ] [ -s <seed> ] [ -t ]"
+
+// Flags for opts_parse_with(), and their usage for the programs that take them
+#define OPTS_MEMORY 1    // -m
+#define OPTS_PLACEMENT 2 // -p
+#define OPTS_USAGE_MEMORY "[ -m ]"
+#define OPTS_USAGE_PLACEMENT "[ -p ]"
+
+typedef struct {
+  const char *stats_path; // -o <file>: per-rank statistics file (implies -v)
+  uid_spec_t uids;        // -u <dist>: see uid.h; UID_DEFAULT keeps the program's own
+  long seed;              // -s <seed>: srand(seed + rank); -1 seeds from the clock
+  int timing;             // -t: synchronize clocks and time the election (timing.h)
+  int memory;             // -m: report stack and resident memory (mem.h), with OPTS_MEMORY
+  int placement;          // -p: messages and idle time per OS process and node (hotspot.h), with OPTS_PLACEMENT
+} run_opts_t;
+
+/**
+ * Fills opts from argv and copies every argument it does not recognise into
+ * args (args[0] is argv[0], args is NULL-terminated).
+ * Returns the new argument count, or -1 if a flag is missing or has a bad value.
+ */
+int opts_parse(int argc, char *argv[], run_opts_t *opts, char *args[OPTS_MAX_ARGS + 1]);
+
+/** Same, and also takes the flags in extra (OPTS_MEMORY, OPTS_PLACEMENT). */
+int opts_parse_with(int argc, char *argv[], run_opts_t *opts, char *args[OPTS_MAX_ARGS + 1], int extra);
+
+/** Seeds rand() for this rank: from -s if it was given, otherwise from the clock. */
+void opts_srand(const run_opts_t *opts, int rank);
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * passthru.c
+ *
+ * Pass-through rank selection and the -m memory report.
+ */
+
+#include <stdio.h>
+#include <fgmpi.h>
+#include "mem.h"
+#include "passthru.h"
+
+int passthru_rank(int rank, unsigned seed) {
+  unsigned x = (unsigned) rank * 0x9E3779B1u ^ (seed + 1) * 0x85EBCA77u;
+  x ^= x >> 15, x *= 0x2C1B3C6Du, x ^= x >> 12, x *= 0x297A2D39u, x ^= x >> 15;
+  return x % PASSTHRU_ONE_IN == 0;
+}
+
+void passthru_mem_report(int forwarder, size_t stack, MPI_Comm comm) {
+  int rank, start;
+  MPI_Comm_rank(comm, &rank);
+  MPIX_Get_collocated_startrank(&start);
+
+  // Sums: { forwarders, forwarder stack, election ranks, election stack, OS processes, rss }
+  // Maxima: { forwarder stack, election stack }
+  long rss = rank == start ? mem_rss_kb() : 0;
+  double sum[6] = { forwarder, forwarder ? stack : 0, !forwarder, forwarder ? 0 : stack, rank == start, rss }, tsum[6];
+  long long max[2] = { forwarder ? (long long) stack : 0, forwarder ? 0 : (long long) stack }, tmax[2];
+  MPI_Reduce(sum, tsum, 6, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(max, tmax, 2, MPI_LONG_LONG, MPI_MAX, 0, comm);
+
+  if (!rank) {
+    printf("Memory: forwarders=%.0f, forwarder_stack=%.0f (max %lld), election_ranks=%.0f, election_stack=%.0f (max %lld), "
+           "os_procs=%.0f, rss_kb=%.0f, rss_kb_per_rank=%.1f\n", tsum[0], tsum[0] ? tsum[1] / tsum[0] : 0, tmax[0],
+           tsum[2], tsum[2] ? tsum[3] / tsum[2] : 0, tmax[1], tsum[4], tsum[5], tsum[5] / (tsum[0] + tsum[2]));
+  }
+}
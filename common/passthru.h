@@ -0,0 +1,29 @@
+/**
+ * passthru.h
+ *
+ * Pass-through ranks of hs-passthru and lcr-passthru: one rank in
+ * PASSTHRU_ONE_IN only relays messages. Which ones is a hash of the rank and
+ * the -s seed (0 without -s), so binding_func can tell before MPI_Init and
+ * bind those ranks to a forwarder with no election state at all.
+ */
+
+#ifndef PASSTHRU_H
+#define PASSTHRU_H
+
+#include <stddef.h>
+#include <mpi.h>
+
+#define PASSTHRU_ONE_IN 5
+
+/** Whether rank only relays messages. */
+int passthru_rank(int rank, unsigned seed);
+
+/**
+ * Collective over comm, for -m. forwarder says whether this rank ran the
+ * forwarder, stack is its painted stack use (mem.h). Rank 0 prints the mean
+ * and largest stack of forwarders and election ranks and the resident memory
+ * of the OS processes, overall and per co-located rank.
+ */
+void passthru_mem_report(int forwarder, size_t stack, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * recv.c
+ *
+ * Blocking, bounded polling and spinning receives, and their CPU cost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fgmpi.h>
+#include "recv.h"
+
+static const char *names[] = { "block", "poll", "spin" };
+
+int recv_parse(const char *s, recv_t *r) {
+  memset(r, 0, sizeof(*r));
+  r->polls = RECV_POLLS;
+  if (!strcmp(s, "block")) r->mode = RECV_BLOCK;
+  else if (!strcmp(s, "spin")) r->mode = RECV_SPIN;
+  else if (!strncmp(s, "poll", 4) && (!s[4] || (s[4] == ':' && (r->polls = atoi(s + 5)) > 0))) r->mode = RECV_POLL;
+  else return 1;
+  return 0;
+}
+
+const char *recv_name(const recv_t *r, char *buf) {
+  if (r->mode != RECV_POLL) return names[r->mode];
+  sprintf(buf, "poll:%d", r->polls);
+  return buf;
+}
+
+void recv_start(recv_t *r) {
+  int colocated;
+
+  MPIX_Get_collocated_size(&colocated);
+  if (r->mode == RECV_SPIN && colocated > 1) {
+    printf("Usage: -w spin needs one process per OS process (-nfg 1); use poll:1 instead\n");
+    exit(1);
+  }
+  getrusage(RUSAGE_SELF, &r->start);
+}
+
+/** Waits by the strategy, untimed. */
+static void wait_any(recv_t *r, int count, MPI_Request *reqs, int *index, MPI_Status *status) {
+  int i, flag, active, tests = 0;
+
+  if (r->mode == RECV_BLOCK) {
+    r->blocks++;
+    MPI_Waitany(count, reqs, index, status);
+    return;
+  }
+  while (1) {
+    for (i = active = 0; i < count; i++) {
+      if (reqs[i] == MPI_REQUEST_NULL) continue;
+      active = 1;
+      MPI_Test(&reqs[i], &flag, status);
+      if (flag) {
+        *index = i;
+        return;
+      }
+      r->tests++;
+    }
+    if (!active) {
+      *index = MPI_UNDEFINED;
+      return;
+    }
+    if (r->mode == RECV_POLL && ++tests >= r->polls) {
+      MPIX_Yield();
+      r->yields++, tests = 0;
+    }
+  }
+}
+
+/** Receives by the strategy, untimed. */
+static void msg(recv_t *r, void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+                MPI_Status *status) {
+  MPI_Request request;
+  int index;
+
+  if (r->mode == RECV_BLOCK) {
+    r->blocks++;
+    MPI_Recv(buf, count, type, source, tag, comm, status);
+  } else {
+    MPI_Irecv(buf, count, type, source, tag, comm, &request);
+    wait_any(r, 1, &request, &index, status);
+  }
+}
+
+void recv_waitany(recv_t *r, int count, MPI_Request *reqs, int *index, MPI_Status *status) {
+  double t0;
+
+  if (!r) {
+    MPI_Waitany(count, reqs, index, status);
+    return;
+  }
+  if (!r->timed) {
+    wait_any(r, count, reqs, index, status);
+    return;
+  }
+  t0 = MPI_Wtime();
+  wait_any(r, count, reqs, index, status);
+  r->waited += MPI_Wtime() - t0;
+}
+
+void recv_msg(recv_t *r, void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+              MPI_Status *status) {
+  double t0;
+
+  if (!r) {
+    MPI_Recv(buf, count, type, source, tag, comm, status);
+    return;
+  }
+  if (!r->timed) {
+    msg(r, buf, count, type, source, tag, comm, status);
+    return;
+  }
+  t0 = MPI_Wtime();
+  msg(r, buf, count, type, source, tag, comm, status);
+  r->waited += MPI_Wtime() - t0;
+}
+
+static double seconds(struct timeval tv) {
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+void recv_report(const recv_t *r, double latency, MPI_Comm comm) {
+  struct rusage now;
+  int rank, size, start;
+  char name[16];
+
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  MPIX_Get_collocated_startrank(&start);
+
+  // Every co-located process is done with the election before its OS process is measured
+  MPI_Barrier(comm);
+  memset(&now, 0, sizeof(now));
+  if (rank == start) getrusage(RUSAGE_SELF, &now);
+
+  // Sums: { OS processes, user, system, voluntary, involuntary, tests, yields, blocks }
+  double sum[8] = { 0 }, tsum[8], tmax;
+  if (rank == start) {
+    sum[0] = 1;
+    sum[1] = seconds(now.ru_utime) - seconds(r->start.ru_utime);
+    sum[2] = seconds(now.ru_stime) - seconds(r->start.ru_stime);
+    sum[3] = now.ru_nvcsw - r->start.ru_nvcsw;
+    sum[4] = now.ru_nivcsw - r->start.ru_nivcsw;
+  }
+  sum[5] = r->tests, sum[6] = r->yields, sum[7] = r->blocks;
+  MPI_Reduce(sum, tsum, 8, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(&latency, &tmax, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  if (!rank) {
+    printf("Recv: strategy=%s, ranks=%d, os_procs=%.0f, cpu_s=%.3f (user %.3f, sys %.3f), cpu_s_per_rank=%.6f, "
+           "vcsw=%.0f, ivcsw=%.0f, tests=%.0f, yields=%.0f, blocks=%.0f, latency=%.6f\n", recv_name(r, name), size,
+           tsum[0], tsum[1] + tsum[2], tsum[1], tsum[2], (tsum[1] + tsum[2]) / size, tsum[3], tsum[4], tsum[5],
+           tsum[6], tsum[7], tmax);
+  }
+}
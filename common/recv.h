@@ -0,0 +1,67 @@
+/**
+ * recv.h
+ *
+ * How hs and lcr wait for election messages (-w). When a co-located process
+ * blocks in a receive, FG-MPI switches to another co-located process; the
+ * alternatives keep the CPU and poll:
+ *   block        MPI_Recv / MPI_Waitany, the default
+ *   poll[:<n>]   MPI_Test up to n times (default RECV_POLLS), then MPIX_Yield
+ *                and start over
+ *   spin         MPI_Test until the message is there, never yielding
+ * spin only makes sense with one process per OS process: nothing else there
+ * runs while it spins, so a co-located sender would never get to send, and
+ * recv_start() refuses it under co-location.
+ *
+ * recv_report() gives the CPU time and context switches of the OS processes
+ * (getrusage) next to the tests, yields and blocking waits of the ranks and
+ * the election latency, so strategies can be compared for each -nfg.
+ */
+
+#ifndef RECV_H
+#define RECV_H
+
+#include <mpi.h>
+#include <sys/resource.h>
+
+#define RECV_POLLS 64
+
+typedef enum { RECV_BLOCK, RECV_POLL, RECV_SPIN } recv_mode_t;
+
+typedef struct {
+  recv_mode_t mode;
+  int polls;                  // MPI_Test calls between yields (poll)
+  long tests, yields, blocks; // failed MPI_Tests, MPIX_Yields and blocking waits so far
+  int timed;                  // set by the caller to keep waited; off, receives call no MPI_Wtime
+  double waited;              // seconds in recv_waitany and recv_msg, if timed
+  struct rusage start;        // of this OS process at recv_start()
+} recv_t;
+
+/** Returns 0 and fills r, counters zeroed, if s names a strategy. */
+int recv_parse(const char *s, recv_t *r);
+
+/** The strategy as recv_parse() takes it, e.g. "poll:64"; buf needs 16 bytes. */
+const char *recv_name(const recv_t *r, char *buf);
+
+/** After MPI_Init, where the election starts; exits if spin is asked for under co-location. */
+void recv_start(recv_t *r);
+
+/**
+ * MPI_Waitany by r's strategy; r NULL blocks. Returns with *index MPI_UNDEFINED
+ * if every request is MPI_REQUEST_NULL.
+ */
+void recv_waitany(recv_t *r, int count, MPI_Request *reqs, int *index, MPI_Status *status);
+
+/** MPI_Recv by r's strategy; r NULL blocks. */
+void recv_msg(recv_t *r, void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm,
+              MPI_Status *status);
+
+/**
+ * Collective over comm, after the election. latency is this rank's time in
+ * it. Rank 0 prints the strategy, the CPU time (user and system), voluntary
+ * and involuntary context switches summed over the OS processes since their
+ * recv_start(), the tests, yields and blocking waits summed over the ranks,
+ * and the longest latency.
+ */
+void recv_report(const recv_t *r, double latency, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * stats.c
+ *
+ * Collective output of per-rank election statistics.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+#define STATS_HEADER "rank,uid,leader,initiator,participant,mrcvd,msent,phase,elapsed\n"
+#define STATS_ROW_FMT "%10d,%11d,%1d,%1d,%1d,%10d,%10d,%4d,%14.6f\n"
+#define STATS_ROW_LEN (10+1 + 11+1 + 1+1 + 1+1 + 1+1 + 10+1 + 10+1 + 4+1 + 14+1)
+
+static int is_binary(const char *path) {
+  size_t len = strlen(path);
+  return len > 4 && !strcmp(path + len - 4, ".bin");
+}
+
+int stats_write(const char *path, const rank_stats_t *s, MPI_Comm comm) {
+  int rank, size, rc, len;
+  int hdr_len = (int) strlen(STATS_HEADER);
+  char buf[sizeof(STATS_HEADER) + STATS_ROW_LEN + 1];
+  MPI_Offset offset, total;
+  MPI_File fh;
+  MPI_Status status;
+
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  if (is_binary(path)) {
+    memcpy(buf, s, sizeof(*s));
+    len = (int) sizeof(*s);
+    offset = (MPI_Offset) rank * len;
+    total = (MPI_Offset) size * len;
+  } else {
+    // Rank 0 writes the header in front of its own row, in the same call
+    len = 0;
+    if (!rank) len = hdr_len, memcpy(buf, STATS_HEADER, hdr_len);
+    snprintf(buf + len, STATS_ROW_LEN + 1, STATS_ROW_FMT, s->rank, s->uid, s->leader,
+             s->initiator, s->participant, s->mrcvd, s->msent, s->phase, s->elapsed);
+    len += STATS_ROW_LEN;
+    buf[len - 1] = '\n'; // keep the row boundary even if a field overflowed its width
+    offset = rank ? hdr_len + (MPI_Offset) rank * STATS_ROW_LEN : 0;
+    total = hdr_len + (MPI_Offset) size * STATS_ROW_LEN;
+  }
+
+  rc = MPI_File_open(comm, (char *) path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+  if (rc != MPI_SUCCESS) goto out;
+  rc = MPI_File_set_size(fh, total); // truncate whatever a larger earlier run left behind
+  if (rc == MPI_SUCCESS)
+    rc = MPI_File_write_at_all(fh, offset, buf, len, MPI_CHAR, &status);
+  MPI_File_close(&fh);
+
+out:
+  if (rc != MPI_SUCCESS && !rank) fprintf(stderr, "Could not write statistics to %s\n", path);
+  return rc;
+}
@@ -0,0 +1,37 @@
+/**
+ * stats.h
+ *
+ * Per-rank election statistics. Every process fills in one fixed-size record
+ * and all records are written with a single collective MPI-IO call, rather than
+ * each process calling printf (which serializes on stdout at a million ranks).
+ *
+ * The file is fixed-width CSV, or raw rank_stats_t records if the path ends in
+ * ".bin". Record i always sits at a fixed offset, so row i is rank i.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <mpi.h>
+
+#define STATS_DEFAULT_PATH "stats.csv"
+
+typedef struct {
+  int rank;
+  int uid;
+  int leader;      // 1 if this process was elected
+  int initiator;   // 1 if this process started an election on its own
+  int participant; // 0 for processes that only ever relayed messages
+  int mrcvd;       // messages received during the election
+  int msent;       // messages sent during the election
+  int phase;       // last HS phase seen; always 0 for LCR
+  double elapsed;  // local seconds from MPI_Init to the end of the election
+} rank_stats_t;
+
+/**
+ * Collective over comm. Writes this process's record to path.
+ * Returns MPI_SUCCESS, or the MPI error code of the first call that failed.
+ */
+int stats_write(const char *path, const rank_stats_t *s, MPI_Comm comm);
+
+#endif
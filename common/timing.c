@@ -0,0 +1,121 @@
+/**
+ * timing.c
+ *
+ * Clock-offset estimation and election phase timestamps.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fgmpi.h>
+#include "timing.h"
+
+// Tags are private to the duplicated communicator, but kept clear of the
+// election tags so per-tag profiles (prof/) don't mix them up
+#define TAG_PING 50
+#define TAG_PONG 51
+#define TAG_OFFSET 52
+
+// Reduced with MPI_MIN; maxima are negated on the way in and out
+enum { R_START, R_LEADER, R_END, R_SKEW, R_PHASE, R_COUNT = R_PHASE + TIMING_MAX_PHASES };
+
+static void sync_clock(timing_t *t) {
+  int rank, start, colsize, nstarts, i, j;
+  double sample[2];
+  MPI_Status status;
+
+  MPI_Comm_rank(t->comm, &rank);
+  MPIX_Get_collocated_startrank(&start);
+  MPIX_Get_collocated_size(&colsize);
+
+  // Only the first process in each OS process needs to talk to rank 0
+  int is_start = (rank == start);
+  MPI_Reduce(&is_start, &nstarts, 1, MPI_INT, MPI_SUM, 0, t->comm);
+
+  if (!rank) {
+    // Serve every other OS process, in whatever order their pings arrive
+    for (i = 0; i < (nstarts - 1) * TIMING_PINGS; i++) {
+      MPI_Recv(NULL, 0, MPI_INT, MPI_ANY_SOURCE, TAG_PING, t->comm, &status);
+      double now = MPI_Wtime();
+      MPI_Send(&now, 1, MPI_DOUBLE, status.MPI_SOURCE, TAG_PONG, t->comm);
+    }
+  } else if (is_start) {
+    double best = -1;
+    for (i = 0; i < TIMING_PINGS; i++) {
+      double t0 = MPI_Wtime(), server;
+      MPI_Send(NULL, 0, MPI_INT, 0, TAG_PING, t->comm);
+      MPI_Recv(&server, 1, MPI_DOUBLE, 0, TAG_PONG, t->comm, &status);
+      double t1 = MPI_Wtime();
+      if (best < 0 || t1 - t0 < best) {
+        best = t1 - t0;
+        t->offset = server - (t0 + t1) / 2;
+        t->skew = best / 2;
+      }
+    }
+  }
+
+  // Co-located processes share the clock, so they share the offset
+  if (is_start) {
+    sample[0] = t->offset, sample[1] = t->skew;
+    for (j = start + 1; j < start + colsize; j++)
+      MPI_Send(sample, 2, MPI_DOUBLE, j, TAG_OFFSET, t->comm);
+  } else {
+    MPI_Recv(sample, 2, MPI_DOUBLE, start, TAG_OFFSET, t->comm, &status);
+    t->offset = sample[0], t->skew = sample[1];
+  }
+}
+
+void timing_init(timing_t *t, int enabled, MPI_Comm comm) {
+  memset(t, 0, sizeof(*t));
+  t->enabled = enabled;
+  if (!enabled) return;
+
+  MPI_Comm_dup(comm, &t->comm);
+  sync_clock(t);
+  MPI_Barrier(t->comm);
+}
+
+double timing_now(const timing_t *t) {
+  return MPI_Wtime() + t->offset;
+}
+
+void timing_start(timing_t *t) {
+  if (t->enabled) t->t_start = timing_now(t);
+}
+
+void timing_phase(timing_t *t, int k) {
+  if (t->enabled && k >= 0 && k < TIMING_MAX_PHASES && t->phase[k] == 0) t->phase[k] = timing_now(t);
+}
+
+void timing_leader(timing_t *t) {
+  if (t->enabled) t->t_leader = timing_now(t);
+}
+
+void timing_end(timing_t *t) {
+  if (t->enabled) t->t_end = timing_now(t);
+}
+
+void timing_report(timing_t *t, int is_leader, const char *label) {
+  double in[R_COUNT], out[R_COUNT];
+  int k;
+
+  if (!t->enabled) return;
+
+  in[R_START] = t->t_start;
+  in[R_LEADER] = t->t_leader ? -t->t_leader : 0;
+  in[R_END] = -t->t_end;
+  in[R_SKEW] = -t->skew;
+  for (k = 0; k < TIMING_MAX_PHASES; k++) in[R_PHASE + k] = t->phase[k] ? t->phase[k] : 1e300;
+
+  MPI_Allreduce(in, out, R_COUNT, MPI_DOUBLE, MPI_MIN, t->comm);
+  MPI_Comm_free(&t->comm);
+
+  if (!is_leader) return;
+
+  double start = out[R_START];
+  printf("Timing: to_leader=%.6f, to_quiescence=%.6f, leader_to_quiescence=%.6f, max_skew=%.6f\n",
+         -out[R_LEADER] - start, -out[R_END] - start, out[R_LEADER] - out[R_END], -out[R_SKEW]);
+  printf("Timing: first reached");
+  for (k = 0; k < TIMING_MAX_PHASES && out[R_PHASE + k] < 1e300; k++)
+    printf(" %s%d=%.6f", label, k, out[R_PHASE + k] - start);
+  printf("\n");
+}
@@ -0,0 +1,55 @@
+/**
+ * timing.h
+ *
+ * Wall-clock timing of an election across OS processes. MPI_Wtime is only
+ * comparable within one OS process, so at startup each OS process estimates
+ * its offset from rank 0's clock with a ping-pong exchange (the sample with
+ * the smallest round trip wins) and passes it on to its co-located FG-MPI
+ * processes, which share its clock. All timestamps are then in rank 0's time.
+ *
+ * Each process stamps the start of the election, the first time it sees each
+ * HS phase or LCR lap, when it declares itself leader and when it leaves the
+ * election. timing_report() reduces these and has the leader print the time
+ * to leader and the time to quiescence, measured from the earliest start, and
+ * between the two, which is what announcing the leader costs.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <mpi.h>
+
+#define TIMING_MAX_PHASES 40
+#define TIMING_PINGS 8
+
+typedef struct {
+  int enabled;
+  MPI_Comm comm;      // private duplicate, so no tag can collide with the election
+  double offset;      // MPI_Wtime() + offset = rank 0's clock
+  double skew;        // round trip / 2 of the sample the offset came from
+  double t_start, t_leader, t_end;
+  double phase[TIMING_MAX_PHASES]; // first time each phase was seen, 0 if never
+} timing_t;
+
+/**
+ * Collective over comm when enabled; does nothing otherwise. Estimates the clock
+ * offset and ends in a barrier, so every process starts the election together.
+ */
+void timing_init(timing_t *t, int enabled, MPI_Comm comm);
+
+/** Synchronized time now. */
+double timing_now(const timing_t *t);
+
+void timing_start(timing_t *t);
+void timing_phase(timing_t *t, int k); // only the first call for each k counts
+void timing_leader(timing_t *t);
+void timing_end(timing_t *t);
+
+/**
+ * Collective. Reduces all stamps; the leader prints the totals and the time
+ * each phase (named by label, e.g. "phase" or "lap") was first reached.
+ * Frees the private communicator.
+ */
+void timing_report(timing_t *t, int is_leader, const char *label);
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * uid.c
+ *
+ * Uid distributions for worst-case and structured benchmarking.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "uid.h"
+
+static const char *names[] = {
+  "default", "arith", "stride", "random", "ascending", "descending",
+  "sawtooth", "bitrev", "perm", "clustered", "file", "load"
+};
+
+static const char *load_names[] = { "load:idle", "load:synthetic", "load:callback" };
+
+static int log2_ceil(unsigned long long x) {
+  int b = 0;
+  while ((1ull << b) < x) b++;
+  return b;
+}
+
+static int sqrt_ceil(int n) {
+  int r = 1;
+  while (r * r < n) r++;
+  return r;
+}
+
+static unsigned mix(unsigned x) {
+  x ^= x >> 16, x *= 0x7feb352du;
+  x ^= x >> 15, x *= 0x846ca68bu;
+  return x ^ (x >> 16);
+}
+
+/**
+ * Seeded bijection on 0..n-1: a 4-round Feistel network on the smallest even
+ * number of bits covering n, cycle-walked back into range. The domain is less
+ * than 4n, so the expected number of walks is under 4.
+ */
+static int permute(int x, int n, unsigned seed) {
+  int half = (log2_ceil(n) + 1) / 2, r;
+  unsigned mask = (1u << half) - 1;
+  if (half == 0) return x;
+
+  do {
+    unsigned l = (unsigned) x >> half, rt = (unsigned) x & mask;
+    for (r = 0; r < 4; r++) {
+      unsigned t = l ^ (mix(rt ^ seed ^ (r * 0x9e3779b9u)) & mask);
+      l = rt, rt = t;
+    }
+    x = (int) ((l << half) | rt);
+  } while (x >= n);
+
+  return x;
+}
+
+static unsigned reverse_bits(unsigned x, int bits) {
+  unsigned y = 0;
+  int i;
+  for (i = 0; i < bits; i++, x >>= 1) y = (y << 1) | (x & 1);
+  return y;
+}
+
+/**
+ * Position of rank in the bit-reversal order of 0..n-1, i.e. how many j < n have
+ * rev(j) < rev(rank). Counts the y < rev(rank) with rev(y) < n one bit at a time.
+ */
+static int bitrev_order(int rank, int n) {
+  int b = log2_ceil(n), i, count = 0;
+  unsigned v = reverse_bits(rank, b);
+
+  for (i = b - 1; i >= 0; i--) {
+    if (!(v & (1u << i))) continue;
+    // y: v's bits above i, 0 at bit i, anything below. The fixed bits become the
+    // low b-i bits of rev(y); the i free bits cover every high part once.
+    unsigned low = reverse_bits(v >> i & ~1u, b - i);
+    unsigned lowmask = (1u << (b - i)) - 1;
+    count += (n >> (b - i)) + (low < ((unsigned) n & lowmask));
+  }
+
+  return count;
+}
+
+static int uid_from_file(const char *path, int rank) {
+  long page = sysconf(_SC_PAGESIZE);
+  off_t at = (off_t) rank * sizeof(int), base = at - at % page;
+  int fd = open(path, O_RDONLY), uid;
+  void *map;
+
+  if (fd < 0 || lseek(fd, 0, SEEK_END) < at + (off_t) sizeof(int)) {
+    fprintf(stderr, "uid file %s is missing or has no entry for rank %d\n", path, rank);
+    exit(1);
+  }
+  map = mmap(NULL, (size_t) (at - base) + sizeof(int), PROT_READ, MAP_SHARED, fd, base);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "Could not map uid file %s\n", path);
+    exit(1);
+  }
+  uid = *(int *) ((char *) map + (at - base));
+  munmap(map, (size_t) (at - base) + sizeof(int));
+
+  return uid;
+}
+
+/** Idle CPUs over online CPUs: 1 - 1-minute load average / CPUs, clamped. */
+static double idle_capacity(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  double load;
+  FILE *f = fopen("/proc/loadavg", "r");
+
+  if (!f) return 0;
+  if (fscanf(f, "%lf", &load) != 1) load = cpus;
+  fclose(f);
+  if (cpus < 1) cpus = 1;
+  if (load > cpus) return 0;
+  return 1 - load / cpus;
+}
+
+/** Quantizes capacity to the levels that fit above the rank. */
+static int load_uid(double capacity, int rank, int size) {
+  int levels = INT_MAX / size;
+  if (capacity < 0) capacity = 0;
+  if (capacity > 1) capacity = 1;
+  return (int) (capacity * (levels - 1) + 0.5) * size + rank;
+}
+
+double uid_capacity(int uid, int size) {
+  int levels = INT_MAX / size;
+  return levels > 1 ? (double) (uid / size) / (levels - 1) : 0;
+}
+
+int uid_parse(const char *str, uid_spec_t *spec) {
+  const char *colon = strchr(str, ':');
+  size_t len = colon ? (size_t) (colon - str) : strlen(str);
+  int d;
+
+  for (d = UID_ARITH; d <= UID_LOAD; d++)
+    if (strlen(names[d]) == len && !strncmp(str, names[d], len)) break;
+  if (d > UID_LOAD) return -1;
+
+  spec->dist = (uid_dist_t) d;
+  spec->param = 0, spec->path = NULL;
+  if (d == UID_FILE) {
+    if (!colon || !colon[1]) return -1;
+    spec->path = colon + 1;
+  } else if (d == UID_LOAD) {
+    if (!colon) return -1;
+    // load:callback needs a load_fn, so only a program can pick it
+    for (d = UID_LOAD_IDLE; d <= UID_LOAD_SYNTHETIC; d++)
+      if (!strcmp(str, load_names[d])) break;
+    if (d > UID_LOAD_SYNTHETIC) return -1;
+    spec->load = (uid_load_t) d;
+  } else if (colon) {
+    if (d != UID_SAWTOOTH && d != UID_CLUSTERED) return -1;
+    spec->param = atoi(colon + 1);
+    if (spec->param <= 0) return -1;
+  }
+
+  return 0;
+}
+
+int uid_generate(const uid_spec_t *spec, int rank, int size, int pnum) {
+  int p = spec->param ? spec->param : sqrt_ceil(size);
+
+  switch (spec->dist) {
+    case UID_ARITH: return (int) (((long long) (rank+1) * pnum) % size);
+    case UID_STRIDE: return (rank+1) * (pnum % size);
+    case UID_ASCENDING: return rank;
+    case UID_DESCENDING: return size - 1 - rank;
+    case UID_BITREV: return bitrev_order(rank, size);
+    case UID_PERM: return permute(rank, size, spec->seed);
+    case UID_FILE: return uid_from_file(spec->path, rank);
+
+    case UID_LOAD:
+      if (spec->load == UID_LOAD_IDLE) return load_uid(idle_capacity(), rank, size);
+      if (spec->load == UID_LOAD_SYNTHETIC) return load_uid(mix(rank ^ mix(spec->seed + 1)) / 4294967296.0, rank, size);
+      if (!spec->load_fn) {
+        fprintf(stderr, "load:callback needs a load function from the program\n");
+        exit(1);
+      }
+      return load_uid(spec->load_fn(rank, size, spec->load_arg), rank, size);
+
+    case UID_SAWTOOTH: {
+      // Order by (position in tooth, tooth), counting the shorter last tooth
+      int full = size / p, rem = size % p, q = rank % p;
+      return q * full + (q < rem ? q : rem) + rank / p;
+    }
+
+    case UID_CLUSTERED:
+      if (p > size) p = size;
+      if (rank >= size - p) return size - 1 - (rank - (size - p));
+      return permute(rank, size - p, spec->seed);
+
+    case UID_RANDOM:
+    default:
+      return rand() % pnum;
+  }
+}
+
+const char *uid_name(const uid_spec_t *spec) {
+  return spec->dist == UID_LOAD ? load_names[spec->load] : names[spec->dist];
+}
@@ -0,0 +1,89 @@
+/**
+ * uid.h
+ *
+ * Uid assignment for the election programs. Besides each program's own
+ * default, a run can pick a structured or adversarial distribution:
+ *
+ *   arith       ((rank+1)*pnum) % size, the deterministic hs/lcr formula
+ *   stride      (rank+1)*(pnum % size), the deterministic lcr.c formula
+ *   random      rand() % pnum
+ *   ascending   rank; every LCR probe dies after one hop (best case)
+ *   descending  size-1-rank; LCR probes run to the wrap, O(n^2) messages
+ *   sawtooth:P  teeth of length P (default ceil(sqrt(n))) rising in rank order
+ *   bitrev      bit-reversal order of the rank; many HS candidates survive
+ *               each phase, close to the worst case in the hs.c header
+ *   perm        seeded random permutation of 0..size-1
+ *   clustered:M the M largest uids (default ceil(sqrt(n))) packed into the
+ *               last M ranks, largest first; the rest a seeded permutation
+ *   file:PATH   uid = PATH[rank], native 32-bit ints; only the page holding
+ *               this rank's entry is mapped
+ *   load:SRC    capacity * size + rank, so the least loaded process wins and
+ *               ties go to the higher rank. Capacity is in [0, 1], quantized
+ *               to INT_MAX / size levels, and comes from SRC:
+ *                 idle       idle CPUs from /proc/loadavg over online CPUs,
+ *                            the same for every rank of an OS process
+ *                 synthetic  a seeded per-rank value, reproducible across runs
+ *                 callback   spec->load_fn; not a -u name, a program sets
+ *                            load = UID_LOAD_CALLBACK and load_fn itself
+ *
+ * Everything except random, file and load is computed from (rank, size, pnum,
+ * seed) in O(1) or O(log n) without communication, and every one except
+ * random, arith (when gcd(size, pnum) != 1), stride, file and load is a
+ * permutation of 0..size-1. stride uids are distinct multiples of
+ * pnum % size, not reduced mod size, when pnum % size != 0. Load uids are
+ * distinct and keep uid % size == rank.
+ */
+
+#ifndef UID_H
+#define UID_H
+
+typedef enum {
+  UID_DEFAULT,  // whatever the program did before -u existed
+  UID_ARITH,
+  UID_STRIDE,
+  UID_RANDOM,
+  UID_ASCENDING,
+  UID_DESCENDING,
+  UID_SAWTOOTH,
+  UID_BITREV,
+  UID_PERM,
+  UID_CLUSTERED,
+  UID_FILE,
+  UID_LOAD
+} uid_dist_t;
+
+typedef enum { UID_LOAD_IDLE, UID_LOAD_SYNTHETIC, UID_LOAD_CALLBACK } uid_load_t;
+
+/** Capacity of rank in [0, 1], higher for less loaded. */
+typedef double (*uid_load_fn)(int rank, int size, void *arg);
+
+typedef struct {
+  uid_dist_t dist;
+  int param;         // sawtooth period or cluster size; 0 picks ceil(sqrt(n))
+  unsigned seed;     // permutation key for perm and clustered
+  const char *path;  // file:PATH
+  uid_load_t load;   // load:SRC
+  uid_load_fn load_fn;
+  void *load_arg;
+} uid_spec_t;
+
+/**
+ * Parses "name[:param]" into spec (seed and load_fn are left alone).
+ * Returns 0, or -1 for an unknown distribution; load:callback is unknown here.
+ */
+int uid_parse(const char *str, uid_spec_t *spec);
+
+/**
+ * Returns the uid of rank in a ring of size processes. UID_RANDOM draws from
+ * rand(), so the caller's srand() still applies. Exits if a uid file can't be
+ * read or load:callback has no load_fn.
+ */
+int uid_generate(const uid_spec_t *spec, int rank, int size, int pnum);
+
+/** Capacity a load uid was made from, in a ring of size processes. */
+double uid_capacity(int uid, int size);
+
+/** Name of the distribution, for the output line. */
+const char *uid_name(const uid_spec_t *spec);
+
+#endif
@@ -0,0 +1,384 @@
+/**
+ * dynring.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./dynring [ -c <changes> ] [ -i <initial members> ] [ -L <percent> ] [ -a hs|lcr|chord ] [ -b tree|ibcast ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ * (uids are random unless -u says otherwise, as in hs.c)
+ *
+ * A ring whose membership changes while it runs, with the leader kept up to
+ * date incrementally instead of by a fresh election after every change. The
+ * first <initial members> ranks (default half) form the ring and elect a
+ * leader with libelect; the rest wait in a pool. Then <changes> times
+ * (default 20) a pool process joins or a member leaves, at random but the
+ * same on every process (the membership service's view); <percent> of the
+ * leaves (default 25) are the leader's. Only the neighbours splice the ring:
+ *   join    the joiner links itself in between the members either side of
+ *           it, whose acknowledgements carry the leader. A smaller uid
+ *           changes nothing; a larger one makes it the leader outright.
+ *   leave   the leaver links its neighbours to each other. A member leaving
+ *           changes nothing else. The leader leaving starts the one
+ *           re-election needed: its right neighbour, once the left one has
+ *           let go, sends a token once round the ring for the largest uid
+ *           and tells the winner, which takes over.
+ * Everyone already knows the leader, so a leave that keeps it ends with the
+ * splice. After a join, though, only the joiner knows whether it outranked
+ * the leader, so it installs the new view by broadcasting that to every
+ * process: size - 1 messages, counted as view messages. Only a new leader is
+ * announced to every process, pool too (common/announce.h, -b tree by
+ * default). The members then also run a full election with libelect (-a,
+ * default hs) on a communicator of their own, as the job would otherwise
+ * have to, and it must pick the same uid. The barrier before each change
+ * only lines the processes up to start the clock and isn't counted.
+ *
+ * Rank 0 prints, for each kind of change, the mean messages of the splice and
+ * the re-election, of installing the view, of the announcement and the time
+ * until every process knew the leader (clocks synced as for -t), next to the
+ * full election's messages and time. leave_member is splice only; join_lower
+ * adds the view broadcast but no announcement.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "timing.h"
+#include "announce.h"
+#include "elect.h"
+
+// Tags
+#define TAG_JOIN 2
+#define TAG_LEAVE 3
+#define TAG_ACK 4
+#define TAG_COLLECT 5
+#define TAG_ELECTED 6
+
+#define SIZE_MSG 3
+
+// Kinds of change
+enum { JOIN_LOWER, JOIN_HIGHER, LEAVE_MEMBER, LEAVE_LEADER, KINDS };
+static const char *kind_names[] = { "join_lower", "join_higher", "leave_member", "leave_leader" };
+
+// Per-change values summed on rank 0
+enum { A_COUNT, A_SPLICE, A_ELECTION, A_VIEW, A_ANNOUNCE, A_SECONDS, A_FULL_MSGS, A_FULL_SECONDS, A_TOTALS };
+
+typedef struct {
+  int rank, uid, left, right;
+  int leader_uid, leader_rank;
+  int acks;                      // still to come, at the process changing
+  int leaving;                   // this process is leaving
+  long long splice, election;    // messages sent
+  MPI_Comm comm;
+} node_t;
+
+/** FG-MPI Boilerplate begins **/
+int dynring(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&dynring);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+/** The k-th rank, from 0, whose member flag is want, not counting skip. */
+static int pick(const char *member, int size, int want, int skip, int k) {
+  int r;
+  for (r = 0; r < size; r++)
+    if (member[r] == want && r != skip && !k--) return r;
+  return -1;
+}
+
+/** The nearest member from rank in direction dir (1 right, -1 left). */
+static int neighbour(const char *member, int size, int rank, int dir) {
+  int r = rank;
+  do {
+    r = (r + dir + size) % size;
+  } while (!member[r]);
+  return r;
+}
+
+static void post(node_t *n, int dest, int tag, int a, int b, int c, long long *count) {
+  int m[SIZE_MSG] = { a, b, c };
+  MPI_Send(m, SIZE_MSG, MPI_INT, dest, tag, n->comm);
+  (*count)++;
+}
+
+/** Orders uids, then ranks, so equal uids still have one winner. */
+static int beats(int uid, int rank, int other_uid, int other_rank) {
+  return uid > other_uid || (uid == other_uid && rank > other_rank);
+}
+
+/**
+ * The changing process's first move. Its links come from the view when it
+ * joins and are its own when it leaves.
+ */
+static void start_change(node_t *n, int join, const char *member, int size) {
+  if (join) {
+    n->left = neighbour(member, size, n->rank, -1), n->right = neighbour(member, size, n->rank, 1);
+    post(n, n->left, TAG_JOIN, 0, 0, 0, &n->splice);  // I'm your right
+    post(n, n->right, TAG_JOIN, 1, 0, 0, &n->splice); // and your left
+    n->acks = 2;
+  } else if (n->rank != n->leader_rank) {
+    post(n, n->left, TAG_LEAVE, 0, n->right, 0, &n->splice);
+    post(n, n->right, TAG_LEAVE, 1, n->left, 0, &n->splice);
+    n->acks = 2;
+  } else {
+    // The token must not reach the left neighbour before it has let go
+    post(n, n->left, TAG_LEAVE, 0, n->right, 0, &n->splice);
+    n->acks = 1;
+  }
+  n->leaving = !join;
+}
+
+/**
+ * Handles one message. Returns 1 once this process is done: its part of a
+ * splice that keeps the leader is over, or it has announced the new leader.
+ */
+static int handle(node_t *n, int *m, int source, int tag, announce_t *ann) {
+  switch (tag) {
+    case TAG_JOIN:
+      if (m[0]) n->left = source;
+      else n->right = source;
+      post(n, source, TAG_ACK, n->leader_uid, n->leader_rank, 0, &n->splice);
+      return 1;
+
+    case TAG_LEAVE:
+      if (m[0]) n->left = m[1];
+      else n->right = m[1];
+      if (!m[2]) {
+        post(n, source, TAG_ACK, n->leader_uid, n->leader_rank, 0, &n->splice);
+        return source != n->leader_rank; // a leaving leader's left neighbour is in the lap to come
+      }
+      // The leader left: one lap for the largest uid, ending back here
+      post(n, n->right, TAG_COLLECT, n->uid, n->rank, n->rank, &n->election);
+      return 0;
+
+    case TAG_ACK:
+      if (!n->leaving) n->leader_uid = m[0], n->leader_rank = m[1]; // the joiner learns the leader
+      if (--n->acks) return 0;
+      if (n->leaving && n->rank == n->leader_rank) {
+        post(n, n->right, TAG_LEAVE, 1, n->left, 1, &n->splice);
+        return 0;
+      }
+      return 1;
+
+    case TAG_COLLECT:
+      if (m[2] != n->rank) {
+        if (beats(n->uid, n->rank, m[0], m[1])) m[0] = n->uid, m[1] = n->rank;
+        post(n, n->right, TAG_COLLECT, m[0], m[1], m[2], &n->election);
+        return 0;
+      }
+      if (m[1] != n->rank) {
+        post(n, m[1], TAG_ELECTED, 0, 0, 0, &n->election);
+        return 0;
+      }
+      announce_leader(ann, n->uid);
+      return 1;
+
+    case TAG_ELECTED:
+      announce_leader(ann, n->uid);
+      return 1;
+  }
+  return 0;
+}
+
+int dynring(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  elect_algo_t algo = ELECT_HS;
+  announce_mode_t mode = ANNOUNCE_TREE;
+  int changes = 20, initial = 0, leader_pct = 25;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-a")) {
+      if (elect_algo_parse(argv[2], &algo)) break;
+    } else if (!strcmp(argv[1], "-b")) {
+      if (announce_parse(argv[2], &mode) || mode == ANNOUNCE_RING) break;
+    } else if (!strcmp(argv[1], "-c")) {
+      changes = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-i")) {
+      initial = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-L")) {
+      leader_pct = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || changes < 0 || initial < 0 || leader_pct < 0 || leader_pct > 100 || opts.stats_path ||
+      opts.timing) {
+    printf("Usage: ./dynring [ -c <changes> ] [ -i <initial members> ] [ -L <percent> ] [ -a hs|lcr|chord ] [ -b tree|ibcast ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (!initial) initial = size / 2 > 2 ? size / 2 : 2;
+  if (size < 3 || initial < 2 || initial > size) {
+    printf("Usage: dynring needs at least 3 processes and 2 to %d initial members\n", size);
+    exit(1);
+  }
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  node_t n = { .rank = rank, .uid = uid_generate(&opts.uids, rank, size, pnum) };
+  elect_options_t eopts = { n.uid, 0 };
+  elect_result_t res;
+
+  // The schedule comes from one state every process holds a copy of
+  unsigned state = opts.seed < 0 ? (unsigned) time(NULL) : (unsigned) opts.seed;
+  MPI_Bcast(&state, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+  char *member = calloc(size, 1);
+  int members = initial, i, c, k;
+  for (i = 0; i < initial; i++) member[i] = 1;
+  if (member[rank]) {
+    n.left = neighbour(member, size, rank, -1), n.right = neighbour(member, size, rank, 1);
+  }
+
+  // The first leader, by a full election, and made known to the pool
+  MPI_Comm mc;
+  MPI_Comm_split(MPI_COMM_WORLD, member[rank] ? 0 : MPI_UNDEFINED, rank, &mc);
+  int known[2] = { -1, -1 }, leader[2];
+  if (member[rank]) {
+    elect_leader(mc, algo, &eopts, &res);
+    if (res.is_leader) {
+      printf("Leader: rank=%d, id=%d, trcvd=%llu, tsent=%llu, uids=%s\n", rank, res.leader_uid, res.msgs_rcvd,
+             res.msgs_sent, uid_name(&opts.uids));
+    }
+    known[0] = res.leader_uid, known[1] = res.leader_rank; // ranks in mc are world ranks
+    MPI_Comm_free(&mc);
+  }
+  MPI_Allreduce(known, leader, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  n.leader_uid = leader[0], n.leader_rank = leader[1];
+
+  timing_t tm;
+  timing_init(&tm, 1, MPI_COMM_WORLD);
+  MPI_Comm_dup(MPI_COMM_WORLD, &n.comm);
+
+  double acc[KINDS][A_TOTALS];
+  int mismatches = 0;
+  memset(acc, 0, sizeof(acc));
+
+  for (c = 0; c < changes; c++) {
+    int join = members == 2 || (members < size && rand_r(&state) % 2), who;
+    if (join) who = pick(member, size, 0, -1, rand_r(&state) % (size - members));
+    else if (rand_r(&state) % 100 < leader_pct) who = n.leader_rank;
+    else who = pick(member, size, 1, n.leader_rank, rand_r(&state) % (members - 1));
+    int old_leader = n.leader_rank, leader_leaves = !join && who == old_leader;
+    int left = neighbour(member, size, who, -1), right = neighbour(member, size, who, 1);
+
+    announce_t ann;
+    MPI_Status status;
+    int m[SIZE_MSG], done = 0, changed = leader_leaves;
+    long long view = 0; // messages of the view broadcast, as if sent by its root
+    n.splice = n.election = 0;
+    ann.sent = 0;
+
+    MPI_Barrier(n.comm);
+    double t_begin = timing_now(&tm), t_done;
+    if (leader_leaves) {
+      // The re-election takes every member, and the announcement ends it everywhere
+      announce_init(&ann, mode, NULL, n.comm);
+      if (rank == who) start_change(&n, join, member, size);
+      while (!done && !announce_recv(&ann, m, SIZE_MSG, MPI_ANY_SOURCE, &status))
+        done = handle(&n, m, status.MPI_SOURCE, status.MPI_TAG, &ann);
+      announce_end(&ann);
+      n.leader_uid = ann.msg[0], n.leader_rank = ann.msg[1];
+      t_done = timing_now(&tm);
+    } else {
+      // Only the changing process and the members either side of it take part
+      if (rank == who) start_change(&n, join, member, size);
+      if (rank == who || rank == left || rank == right) {
+        while (!done) {
+          MPI_Recv(m, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, n.comm, &status);
+          done = handle(&n, m, status.MPI_SOURCE, status.MPI_TAG, NULL);
+        }
+      }
+      t_done = timing_now(&tm);
+      // Installing the view after a join; the joiner knows the leader by now
+      if (join) {
+        changed = rank == who && beats(n.uid, n.rank, n.leader_uid, n.leader_rank);
+        MPI_Bcast(&changed, 1, MPI_INT, who, n.comm);
+        if (rank == who) view = size - 1;
+      }
+      if (changed) {
+        announce_init(&ann, mode, NULL, n.comm);
+        if (rank == who) announce_leader(&ann, n.uid);
+        else while (!announce_recv(&ann, m, SIZE_MSG, MPI_ANY_SOURCE, &status));
+        announce_end(&ann);
+        n.leader_uid = ann.msg[0], n.leader_rank = ann.msg[1];
+        t_done = timing_now(&tm);
+      }
+    }
+
+    member[who] = join, members += join ? 1 : -1;
+    int kind = join ? (changed ? JOIN_HIGHER : JOIN_LOWER) : (leader_leaves ? LEAVE_LEADER : LEAVE_MEMBER);
+
+    // What a full election on the new ring costs; the first call on a
+    // communicator sets up libelect's cache, so only the second is timed
+    double full = 0;
+    long long full_msgs = 0;
+    int full_uid = -1;
+    MPI_Comm_split(MPI_COMM_WORLD, member[rank] ? 0 : MPI_UNDEFINED, rank, &mc);
+    if (member[rank]) {
+      elect_leader(mc, algo, &eopts, &res);
+      MPI_Barrier(mc);
+      full = MPI_Wtime();
+      elect_leader(mc, algo, &eopts, &res);
+      full = MPI_Wtime() - full;
+      full_msgs = res.msgs_sent, full_uid = res.leader_uid;
+      MPI_Comm_free(&mc);
+    }
+
+    // Minima are negated, so one MPI_MAX does
+    double mx[5] = { -t_begin, t_done, full, full_msgs, full_uid != -1 && full_uid != n.leader_uid }, tmx[5];
+    long long sm[4] = { n.splice, n.election, view, ann.sent }, tsm[4];
+    MPI_Reduce(mx, tmx, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(sm, tsm, 4, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (!rank) {
+      acc[kind][A_COUNT]++;
+      acc[kind][A_SPLICE] += tsm[0], acc[kind][A_ELECTION] += tsm[1];
+      acc[kind][A_VIEW] += tsm[2], acc[kind][A_ANNOUNCE] += tsm[3];
+      acc[kind][A_SECONDS] += tmx[1] + tmx[0];
+      acc[kind][A_FULL_MSGS] += tmx[3], acc[kind][A_FULL_SECONDS] += tmx[2];
+      mismatches += tmx[4] > 0;
+    }
+  }
+
+  if (!rank) {
+    for (k = 0; k < KINDS; k++) {
+      double *a = acc[k], cnt = a[A_COUNT] ? a[A_COUNT] : 1;
+      printf("Change %s: count=%.0f, splice_msgs=%.1f, election_msgs=%.1f, view_msgs=%.1f, announce_msgs=%.1f, "
+             "seconds=%.6f, full_msgs=%.1f, full_seconds=%.6f\n", kind_names[k], a[A_COUNT], a[A_SPLICE] / cnt,
+             a[A_ELECTION] / cnt, a[A_VIEW] / cnt, a[A_ANNOUNCE] / cnt, a[A_SECONDS] / cnt,
+             a[A_FULL_MSGS] / cnt, a[A_FULL_SECONDS] / cnt);
+    }
+    printf("Dynring: n=%d, initial=%d, changes=%d, members=%d, leader=%d, algorithm=%s, announce=%s, %s\n", size,
+           initial, changes, members, n.leader_rank, elect_algo_name(algo), announce_name(mode),
+           mismatches ? "FAILED" : "ok");
+  }
+
+  free(member);
+  MPI_Comm_free(&n.comm);
+  // timing_report() would free the clock's communicator; nothing is reported through it here
+  MPI_Comm_free(&tm.comm);
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * elect-chord.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./elect-chord [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ *
+ * The chordal ring election in libelect (ELECT_CHORD) next to plain HS on the
+ * same uids. The chords are the links to the ranks 2^i away: the tournament
+ * climbs them to rank 0 in ceil(log2 n) hops, and the leader is announced
+ * back down them in as many, where HS spends n hops on its last phase and n
+ * more on the announcement lap. Each algorithm is run once untimed, which
+ * also sets up libelect's cache, then <repeats> times (default 10) between
+ * barriers. Rank 0 prints, for each, the hop depth (the longest chain of
+ * messages each sent on receiving the last), the hops the announcement took,
+ * the messages and the slowest process's mean time per call, and whether both
+ * picked the same leader.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "elect.h"
+
+/** FG-MPI Boilerplate begins **/
+int elect_chord(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&elect_chord);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+int elect_chord(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  int repeats = 10;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  if (argc == 4 && !strcmp(argv[1], "-r")) {
+    repeats = atoi(argv[2]);
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || repeats < 1 || opts.stats_path || opts.timing) {
+    printf("Usage: ./elect-chord [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  elect_options_t eopts = { uid_generate(&opts.uids, rank, size, pnum), 0 };
+
+  elect_algo_t algos[2] = { ELECT_CHORD, ELECT_HS };
+  elect_result_t res[2];
+  int a, i;
+
+  for (a = 0; a < 2; a++) {
+    if (elect_leader(MPI_COMM_WORLD, algos[a], &eopts, &res[a]) != MPI_SUCCESS) {
+      printf("Process %d: elect_leader failed\n", rank);
+      exit(1);
+    }
+    if (a == 0 && res[a].is_leader) {
+      printf("Leader: rank=%d, id=%d, trcvd=%llu, tsent=%llu, uids=%s\n", res[a].leader_rank, res[a].leader_uid,
+             res[a].msgs_rcvd, res[a].msgs_sent, uid_name(&opts.uids));
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_start = MPI_Wtime(), elapsed, t_max;
+    for (i = 0; i < repeats; i++) elect_leader(MPI_COMM_WORLD, algos[a], &eopts, &res[a]);
+    elapsed = (MPI_Wtime() - t_start) / repeats;
+    MPI_Reduce(&elapsed, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (!rank) {
+      printf("Chord: algorithm=%s, depth=%d, announce_depth=%d, msgs=%llu, seconds_per_call=%.6f\n",
+             elect_algo_name(algos[a]), res[a].depth, res[a].announce_depth, res[a].msgs_sent, t_max);
+    }
+  }
+
+  if (!rank) printf("Chord: n=%d, repeats=%d, %s\n", size, repeats,
+                    res[0].leader_rank == res[1].leader_rank ? "ok" : "FAILED");
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * elect-demo.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./elect-demo [ -a hs|lcr|chord ] [ -g <group size> ] [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ *
+ * Calls elect_leader() from libelect (elect/elect.h) the way an application
+ * would: once on MPI_COMM_WORLD, then <repeats> times (default 10) on each
+ * group of <group size> consecutive ranks (default all of them), split off
+ * with MPI_Comm_split. Uids are the world uids from -u (random by default).
+ * Checks that every call agrees with MPI_Allreduce on the largest uid and that
+ * repeated calls on a group pick the same leader, and prints each group's
+ * leader and the mean time per call. With -u load:SRC it also elects once with
+ * random uids and prints the extra messages the load uids cost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "load.h"
+#include "elect.h"
+
+/** FG-MPI Boilerplate begins **/
+int elect_demo(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&elect_demo);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+int elect_demo(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  elect_algo_t algo = ELECT_HS;
+  int group = 0, repeats = 10;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-a")) {
+      if (elect_algo_parse(argv[2], &algo)) break;
+    } else if (!strcmp(argv[1], "-g")) {
+      group = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-r")) {
+      repeats = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || group < 0 || repeats < 1 || opts.stats_path || opts.timing) {
+    printf("Usage: ./elect-demo [ -a hs|lcr|chord ] [ -g <group size> ] [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (!group || group > size) group = size;
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  elect_options_t eopts = { uid_generate(&opts.uids, rank, size, pnum), 0 };
+  elect_result_t res, first;
+  int max_uid, failed = 0, i;
+
+  // The whole job
+  if (elect_leader(MPI_COMM_WORLD, algo, &eopts, &res) != MPI_SUCCESS) {
+    printf("Process %d: elect_leader failed on MPI_COMM_WORLD\n", rank);
+    exit(1);
+  }
+  MPI_Allreduce(&eopts.uid, &max_uid, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (res.leader_uid != max_uid) failed = 1;
+  if (res.is_leader) {
+    printf("Leader: rank=%d, id=%d, trcvd=%llu, tsent=%llu, uids=%s\n", res.leader_rank, res.leader_uid,
+           res.msgs_rcvd, res.msgs_sent, uid_name(&opts.uids));
+  }
+  load_report(&opts.uids, eopts.uid, res.is_leader ? res.leader_uid : -1, size, MPI_COMM_WORLD);
+
+  // The same election with plain random uids, for the messages load uids cost
+  if (opts.uids.dist == UID_LOAD) {
+    uid_spec_t plain = opts.uids;
+    plain.dist = UID_RANDOM;
+    elect_options_t popts = { uid_generate(&plain, rank, size, pnum), 0 };
+    elect_result_t pres;
+    elect_leader(MPI_COMM_WORLD, algo, &popts, &pres);
+    if (!rank) printf("Plain: id=%d, tsent=%llu, load_extra_msgs=%lld\n", pres.leader_uid, pres.msgs_sent,
+                      (long long) res.msgs_sent - (long long) pres.msgs_sent);
+  }
+
+  // Groups of consecutive ranks, each electing repeatedly
+  MPI_Comm comm;
+  int grank, gsize;
+  MPI_Comm_split(MPI_COMM_WORLD, rank / group, rank, &comm);
+  MPI_Comm_rank(comm, &grank);
+  MPI_Comm_size(comm, &gsize);
+  MPI_Allreduce(&eopts.uid, &max_uid, 1, MPI_INT, MPI_MAX, comm);
+
+  MPI_Barrier(comm);
+  double t_start = MPI_Wtime();
+  for (i = 0; i < repeats; i++) {
+    if (elect_leader(comm, algo, &eopts, &res) != MPI_SUCCESS) {
+      printf("Process %d: elect_leader failed on group %d\n", rank, rank / group);
+      exit(1);
+    }
+    if (!i) first = res;
+    if (res.leader_uid != max_uid || res.leader_rank != first.leader_rank) failed = 1;
+  }
+  double elapsed = (MPI_Wtime() - t_start) / repeats;
+
+  if (res.is_leader) {
+    printf("Group %d: size=%d, leader rank=%d (world %d), id=%d, tsent=%llu, seconds_per_call=%.6f\n",
+           rank / group, gsize, grank, rank, res.leader_uid, res.msgs_sent, elapsed);
+  }
+  MPI_Comm_free(&comm);
+
+  int any_failed;
+  MPI_Reduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+  if (!rank) printf("Demo: algorithm=%s, groups=%d, repeats=%d, %s\n", elect_algo_name(algo),
+                    (size + group - 1) / group, repeats, any_failed ? "FAILED" : "ok");
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,226 @@
+/**
+ * elect-groups.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./elect-groups [ -a hs|lcr|chord ] [ -G <groups> ] [ -m contiguous|strided|random ] [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ *
+ * Many independent groups electing at once in one job. MPI_COMM_WORLD is
+ * split into <groups> sub-rings (default 4) with MPI_Comm_split:
+ *   contiguous  group = rank * groups / size, consecutive ranks together
+ *   strided     group = rank % groups
+ *   random      a seeded permutation of the ranks (-s), then cut as contiguous
+ * and each group runs <repeats> elections (default 100) with elect_leader()
+ * from libelect, first one group at a time while the rest wait (isolated),
+ * then every group at once (concurrent).
+ *
+ * FG-MPI places consecutive ranks in one OS process, so contiguous groups
+ * share few OS processes with other groups and strided ones share all of
+ * them. Each group reports how many OS processes it spans, and the run how
+ * many groups each OS process hosts on average, next to the slowdown between
+ * isolated and concurrent elections per second, which is the interference
+ * co-location causes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "elect.h"
+
+// Per-group values gathered at rank 0
+#define G_COLOR 0
+#define G_SIZE 1
+#define G_SPAN 2
+#define G_LEADER 3
+#define G_UID 4
+#define G_SENT 5
+#define G_ISOLATED 6
+#define G_CONCURRENT 7
+#define G_FIELDS 8
+
+typedef enum { CONTIGUOUS, STRIDED, RANDOM } membership_t;
+
+static const char *memberships[] = { "contiguous", "strided", "random" };
+
+int count_distinct(int *vals, int n);
+
+/** FG-MPI Boilerplate begins **/
+int elect_groups(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&elect_groups);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+int elect_groups(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  elect_algo_t algo = ELECT_HS;
+  membership_t membership = CONTIGUOUS;
+  int groups = 4, repeats = 100, i;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-a")) {
+      if (elect_algo_parse(argv[2], &algo)) break;
+    } else if (!strcmp(argv[1], "-G")) {
+      groups = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-r")) {
+      repeats = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-m")) {
+      for (i = 0; i < 3 && strcmp(argv[2], memberships[i]); i++);
+      if (i == 3) break;
+      membership = (membership_t) i;
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || groups < 1 || repeats < 1 || opts.stats_path || opts.timing) {
+    printf("Usage: ./elect-groups [ -a hs|lcr|chord ] [ -G <groups> ] [ -m contiguous|strided|random ] [ -r <repeats> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (groups > size) {
+    printf("Usage: %d groups need at least as many processes\n", groups);
+    exit(1);
+  }
+
+  // Membership
+  int color;
+  if (membership == STRIDED) {
+    color = rank % groups;
+  } else {
+    int pos = rank;
+    if (membership == RANDOM) {
+      uid_spec_t perm = { .dist = UID_PERM, .seed = opts.uids.seed + 1 };
+      pos = uid_generate(&perm, rank, size, pnum);
+    }
+    color = (int) ((long long) pos * groups / size);
+  }
+  MPI_Comm comm;
+  int grank, gsize;
+  MPI_Comm_split(MPI_COMM_WORLD, color, rank, &comm);
+  MPI_Comm_rank(comm, &grank);
+  MPI_Comm_size(comm, &gsize);
+
+  // Co-location: the OS processes this group spans, and the groups in this OS process
+  int start, span, hosted;
+  int *starts = malloc(size * sizeof(int));
+  if (!starts) {
+    printf("Process %d: out of memory\n", rank);
+    exit(1);
+  }
+  MPIX_Get_collocated_startrank(&start);
+  MPI_Allgather(&start, 1, MPI_INT, starts, 1, MPI_INT, comm);
+  span = count_distinct(starts, gsize);
+
+  MPI_Comm os;
+  int osize;
+  MPI_Comm_split(MPI_COMM_WORLD, start, rank, &os);
+  MPI_Comm_size(os, &osize);
+  MPI_Allgather(&color, 1, MPI_INT, starts, 1, MPI_INT, os);
+  hosted = count_distinct(starts, osize);
+  MPI_Comm_free(&os);
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  elect_options_t eopts = { uid_generate(&opts.uids, rank, size, pnum), 0 };
+  elect_result_t res;
+  double t, t_isolated = 0, t_concurrent;
+  int g;
+
+  // Warm up: the first call on a communicator sets up its cache
+  elect_leader(comm, algo, &eopts, &res);
+
+  // One group at a time
+  for (g = 0; g < groups; g++) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (g != color) continue;
+    t = MPI_Wtime();
+    for (i = 0; i < repeats; i++) elect_leader(comm, algo, &eopts, &res);
+    t_isolated = MPI_Wtime() - t;
+  }
+
+  // Every group at once
+  MPI_Barrier(MPI_COMM_WORLD);
+  t = MPI_Wtime();
+  for (i = 0; i < repeats; i++) elect_leader(comm, algo, &eopts, &res);
+  t_concurrent = MPI_Wtime() - t;
+
+  // A group's time is its slowest member's; its first process reports it
+  double times[2] = { t_isolated, t_concurrent }, t_group[2];
+  MPI_Reduce(times, t_group, 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+  int leader_world = rank;
+  MPI_Bcast(&leader_world, 1, MPI_INT, res.leader_rank, comm);
+
+  double mine[G_FIELDS] = { -1 }, *all = NULL;
+  if (!grank) {
+    mine[G_COLOR] = color, mine[G_SIZE] = gsize, mine[G_SPAN] = span, mine[G_LEADER] = leader_world;
+    mine[G_UID] = res.leader_uid, mine[G_SENT] = (double) res.msgs_sent;
+    mine[G_ISOLATED] = t_group[0], mine[G_CONCURRENT] = t_group[1];
+  }
+  if (!rank && !(all = malloc(size * G_FIELDS * sizeof(double)))) {
+    printf("Process %d: out of memory\n", rank);
+    exit(1);
+  }
+  MPI_Gather(mine, G_FIELDS, MPI_DOUBLE, all, G_FIELDS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  // Each OS process's share, split over its members: { groups hosted, 1 }
+  double share[2] = { (double) hosted / osize, 1.0 / osize }, os_total[2];
+  MPI_Reduce(share, os_total, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (!rank) {
+    double iso_sum = 0, conc_max = 0, slowdown = 0;
+    int r;
+    for (r = 0; r < size; r++) {
+      double *v = all + r * G_FIELDS;
+      if (v[G_COLOR] < 0) continue;
+      printf("Group %d: size=%d, os_procs=%d, leader=%d, id=%d, tsent=%.0f, isolated_eps=%.1f, concurrent_eps=%.1f, "
+             "slowdown=%.2f\n", (int) v[G_COLOR], (int) v[G_SIZE], (int) v[G_SPAN], (int) v[G_LEADER], (int) v[G_UID],
+             v[G_SENT], repeats / v[G_ISOLATED], repeats / v[G_CONCURRENT], v[G_CONCURRENT] / v[G_ISOLATED]);
+      iso_sum += v[G_ISOLATED];
+      if (v[G_CONCURRENT] > conc_max) conc_max = v[G_CONCURRENT];
+      slowdown += v[G_CONCURRENT] / v[G_ISOLATED];
+    }
+    printf("Groups: algorithm=%s, groups=%d, membership=%s, repeats=%d, isolated_eps=%.1f, concurrent_eps=%.1f, "
+           "groups_per_os_proc=%.2f, mean_slowdown=%.2f\n", elect_algo_name(algo), groups, memberships[membership],
+           repeats, (double) groups * repeats / iso_sum, (double) groups * repeats / conc_max, os_total[0] / os_total[1],
+           slowdown / groups);
+    free(all);
+  }
+
+  free(starts);
+  MPI_Comm_free(&comm);
+  MPI_Finalize();
+  return 0;
+}
+
+/** Distinct values among n, by sorting them in place. */
+static int cmp_int(const void *a, const void *b) {
+  return (*(const int *) a > *(const int *) b) - (*(const int *) a < *(const int *) b);
+}
+
+int count_distinct(int *v, int n) {
+  int i, k = 0;
+  qsort(v, n, sizeof(int), cmp_int);
+  for (i = 0; i < n; i++) if (!i || v[i] != v[i - 1]) k++;
+  return k;
+}
@@ -0,0 +1,155 @@
+/**
+ * elect-overlap.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./elect-overlap [ -a hs|lcr|chord ] [ -w <work units> ] [ -k <test interval> ] [ -r <repeats> ] [ -P ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ *
+ * How much of an election's latency the non-blocking libelect calls hide
+ * behind application compute. Each of <repeats> rounds (default 20) times,
+ * after a barrier:
+ *   compute   <work units> (default 2000) of a synthetic floating point loop
+ *   elect     a blocking elect_leader() on MPI_COMM_WORLD
+ *   overlap   elect_start(), the same compute with an elect_test() every
+ *             <test interval> units (default 10), then elect_wait()
+ * -P drives the election from a progress thread instead (needs an MPI with
+ * MPI_THREAD_MULTIPLE). Rank 0 prints the slowest rank's mean times and
+ *   hidden = (compute + elect - overlap) / elect,
+ * the share of the election that cost nothing, and how often the election was
+ * already over when the compute finished.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "elect.h"
+
+#define UNIT_ITERS 1000
+
+/** FG-MPI Boilerplate begins **/
+int elect_overlap(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&elect_overlap);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+/** One unit of synthetic compute. */
+static double work(double x) {
+  int i;
+  for (i = 0; i < UNIT_ITERS; i++) x = x * 0.999999 + 1e-6;
+  return x;
+}
+
+int elect_overlap(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  elect_algo_t algo = ELECT_HS;
+  int units = 2000, interval = 10, repeats = 20, threaded = 0;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 1 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-P")) {
+      threaded = 1;
+      argv++, argc--;
+      continue;
+    }
+    if (argc < 3) break;
+    if (!strcmp(argv[1], "-a")) {
+      if (elect_algo_parse(argv[2], &algo)) break;
+    } else if (!strcmp(argv[1], "-w")) {
+      units = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-k")) {
+      interval = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-r")) {
+      repeats = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || units < 0 || interval < 1 || repeats < 1 || opts.stats_path || opts.timing) {
+    printf("Usage: ./elect-overlap [ -a hs|lcr|chord ] [ -w <work units> ] [ -k <test interval> ] [ -r <repeats> ] [ -P ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size, provided;
+  if (threaded) {
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  } else {
+    MPI_Init(&argc, &argv);
+  }
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (threaded && provided != MPI_THREAD_MULTIPLE) {
+    if (!rank) printf("Process %d: -P needs MPI_THREAD_MULTIPLE\n", rank);
+    exit(1);
+  }
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  elect_options_t eopts = { uid_generate(&opts.uids, rank, size, pnum), threaded };
+  elect_result_t res;
+  elect_run_t run;
+  volatile double x = 1.0;    // kept in memory so the compute stays between the clock reads
+  double t_compute = 0, t_elect = 0, t_overlap = 0, t;
+  int early = 0, done, i, j;
+
+  // Warm up: the first call on a communicator sets up its cache
+  elect_leader(MPI_COMM_WORLD, algo, &eopts, &res);
+
+  for (i = 0; i < repeats; i++) {
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    for (j = 0; j < units; j++) x = work(x);
+    t_compute += MPI_Wtime() - t;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    elect_leader(MPI_COMM_WORLD, algo, &eopts, &res);
+    t_elect += MPI_Wtime() - t;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    elect_start(MPI_COMM_WORLD, algo, &eopts, &res, &run);
+    for (done = 0, j = 0; j < units; j++) {
+      x = work(x);
+      if (!done && (j + 1) % interval == 0) elect_test(run, &done);
+    }
+    if (done) early++;
+    else elect_wait(run);
+    t_overlap += MPI_Wtime() - t;
+  }
+
+  // Slowest rank's means; early counts every rank's rounds
+  double local[3] = { t_compute / repeats, t_elect / repeats, t_overlap / repeats }, t_max[3];
+  int t_early;
+  MPI_Reduce(local, t_max, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&early, &t_early, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (!rank) {
+    printf("Leader: rank=%d, id=%d, trcvd=%llu, tsent=%llu, uids=%s\n", res.leader_rank, res.leader_uid,
+           res.msgs_rcvd, res.msgs_sent, uid_name(&opts.uids));
+    printf("Overlap: algorithm=%s, progress=%s, units=%d, interval=%d, compute=%.6f, elect=%.6f, overlap=%.6f, "
+           "hidden=%.1f%%, done_in_compute=%.1f%%\n", elect_algo_name(algo), threaded ? "thread" : "test",
+           units, interval, t_max[0], t_max[1], t_max[2],
+           100 * (t_max[0] + t_max[1] - t_max[2]) / t_max[1], 100.0 * t_early / ((double) repeats * size));
+  }
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,483 @@
+/**
+ * elect.c
+ *
+ * elect_leader() and its non-blocking form over a ring in rank order. See elect.h.
+ *
+ * All algorithms use the same message, { type, direction of travel, uid,
+ * rank, phase, hops, depth }, and order processes by (uid, rank), so any uids
+ * work. depth is one more than the deepest message the sender had received.
+ *
+ * HS: in phase k a candidate sends probes 2^k hops each way. A process with a
+ * smaller key passes a probe on, the last one sends a reply back, and a
+ * process with a larger key swallows it. A candidate that gets both replies
+ * goes on to phase k+1; one whose probe comes all the way round has won.
+ * LCR: every process sends its key right; a process passes on keys larger
+ * than any it has seen and swallows the rest; the key that comes home wins.
+ *
+ * The winner sends ELECTED round the ring to the right. After passing it on
+ * (or getting it back), a process sends FIN both ways and receives until it
+ * has a FIN from both neighbours. MPI does not reorder messages between
+ * one pair of processes on one tag, so by then it has every message meant for
+ * it, and the run leaves nothing in flight.
+ *
+ * Chord: besides left and right, rank r has chords to r +- 2^i. The chords
+ * make a binomial tree rooted at rank 0, r's children being r + 2^i for every
+ * 2^i below r's lowest set bit. Phase i of the tournament is one chord hop:
+ * once r has the largest key from each child it sends the largest of them and
+ * its own to its parent, r - 2^i for that lowest bit. Rank 0 then knows the
+ * leader and sends ELECTED down the same tree, so both take ceil(log2 n)
+ * hops and n - 1 messages. Every process gets exactly one message per child
+ * and one from its parent, the last, so no FIN is needed.
+ *
+ * A run is a state machine around one posted MPI_Irecv: RUNNING until the
+ * process knows the leader, DRAINING until both FINs are in, then REDUCING
+ * while an MPI_Iallreduce sums the message counts. progress() moves it on
+ * with MPI_Test, or with MPI_Wait when the caller is prepared to block, so
+ * elect_leader() is just elect_start() and elect_wait().
+ *
+ * Sends go through a pool of buffers and requests in the cached state, used
+ * round in turn. When the next slot is still in use, another POOL slots are
+ * added rather than waiting for it, so elect_test() never blocks on a peer;
+ * the pool keeps that size for later runs. A run completes only once the
+ * whole pool has.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "elect.h"
+
+// Tags
+#define TAG_ELECTION 2
+
+// Message types
+#define PROBE 1
+#define REPLY 2
+#define ELECTED 3
+#define FIN 4
+
+// Direction of travel
+#define RIGHT 0
+#define LEFT 1
+
+// Stages of a run
+#define IDLE 0
+#define RUNNING 1
+#define DRAINING 2
+#define REDUCING 3
+#define DONE 4
+
+// Chord messages go to a rank, not a side
+#define CHORD 2
+
+#define SIZE_MSG 7
+#define POOL 64
+
+#define CHECK(call) do { int rc_ = (call); if (rc_ != MPI_SUCCESS) return rc_; } while (0)
+
+typedef struct elect_ctx elect_ctx_t;
+
+struct elect_run {
+  elect_ctx_t *c;
+  elect_algo_t algo;
+  elect_result_t *result;
+  int stage;
+  int uid;
+  int best_uid, best_rank;      // LCR and chord: largest key seen so far
+  int phase, replies;           // HS: current phase and replies for it; chord: children heard from
+  int depth, announce_depth;    // deepest message received, hops ELECTED took to get here
+  int leader_uid, leader_rank, announced, finished, fins;
+  unsigned long long local[2], total[2]; // { sent, received }
+  int depths[2], max_depths[2];          // { depth, announce_depth }
+  int rbuf[SIZE_MSG];
+  MPI_Request recv, reduce[2];
+  pthread_t thread;             // progress thread, if the run has one
+  int threaded, rc;
+  int complete;                 // set by the progress thread as it exits
+};
+
+// POOL send slots; more chunks are chained on as the sends in flight need them
+typedef struct pool {
+  int buf[POOL][SIZE_MSG];
+  MPI_Request req[POOL];
+  struct pool *more;
+} pool_t;
+
+struct elect_ctx {
+  MPI_Comm comm;       // private duplicate of the user's communicator
+  int rank, size, left, right;
+  int parent, children; // chord tree: parent (-1 at rank 0), how many children
+  int next, slots;     // next pool slot to send from, slots in all chunks
+  pool_t pool;
+  struct elect_run run; // a communicator has one run at a time
+};
+
+static const char *names[] = { "hs", "lcr", "chord" };
+
+// Created once per OS process, by whichever process calls first, for all the
+// co-located FG-MPI processes too (and progress threads); it only names the
+// attribute, and each process's cache hangs off its own communicator. It is
+// never freed. MPI_Comm_create_keyval is local, so it can't yield to another
+// co-located process inside pthread_once.
+static int keyval = MPI_KEYVAL_INVALID, keyval_rc;
+static pthread_once_t keyval_once = PTHREAD_ONCE_INIT;
+
+static int ctx_delete(MPI_Comm comm, int key, void *attr, void *extra);
+
+static void create_keyval(void) {
+  keyval_rc = MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, ctx_delete, &keyval, NULL);
+}
+
+static int ctx_delete(MPI_Comm comm, int key, void *attr, void *extra) {
+  elect_ctx_t *c = attr;
+  pool_t *p, *more;
+  (void) comm, (void) key, (void) extra;
+  MPI_Comm_free(&c->comm);
+  for (p = c->pool.more; p; p = more) {
+    more = p->more;
+    free(p);
+  }
+  free(c);
+  return MPI_SUCCESS;
+}
+
+/** The cached state for comm, made on the first call. Collective then. */
+static int get_ctx(MPI_Comm comm, elect_ctx_t **ctx) {
+  elect_ctx_t *c;
+  int found, i;
+
+  pthread_once(&keyval_once, create_keyval);
+  CHECK(keyval_rc);
+  CHECK(MPI_Comm_get_attr(comm, keyval, ctx, &found));
+  if (found) return MPI_SUCCESS;
+
+  if (!(c = malloc(sizeof(*c)))) return MPI_ERR_NO_MEM;
+  CHECK(MPI_Comm_dup(comm, &c->comm));
+  MPI_Comm_rank(c->comm, &c->rank);
+  MPI_Comm_size(c->comm, &c->size);
+  c->left = (c->rank + c->size - 1) % c->size, c->right = (c->rank + 1) % c->size;
+  c->parent = c->rank ? c->rank - (c->rank & -c->rank) : -1;
+  for (c->children = 0, i = 1; i < c->size && !(c->rank & i) && c->rank + i < c->size; i <<= 1) c->children++;
+  c->next = 0, c->slots = POOL;
+  c->pool.more = NULL;
+  for (i = 0; i < POOL; i++) c->pool.req[i] = MPI_REQUEST_NULL;
+  c->run.stage = IDLE;
+  CHECK(MPI_Comm_set_attr(comm, keyval, c));
+
+  *ctx = c;
+  return MPI_SUCCESS;
+}
+
+/** Back to IDLE once the run is over, or has failed, so the next one can start. */
+static int finish(elect_run_t r, int rc) {
+  if (r->stage == DONE || rc != MPI_SUCCESS) r->stage = IDLE;
+  return rc;
+}
+
+static int greater(int uid_a, int rank_a, int uid_b, int rank_b) {
+  return uid_a > uid_b || (uid_a == uid_b && rank_a > rank_b);
+}
+
+/**
+ * The next pool slot, or the first of POOL new ones if that is still in use.
+ * Only if they can't be allocated does it wait for the busy slot.
+ */
+static pool_t *take_slot(elect_ctx_t *c, int *slot) {
+  pool_t *p = &c->pool, **tail;
+  int k = c->next, flag = 1;
+
+  while (k >= POOL) p = p->more, k -= POOL;
+  if (p->req[k] != MPI_REQUEST_NULL) MPI_Test(&p->req[k], &flag, MPI_STATUS_IGNORE);
+  if (!flag) {
+    for (tail = &c->pool.more; *tail; tail = &(*tail)->more);
+    if ((*tail = malloc(sizeof(pool_t)))) {
+      p = *tail, p->more = NULL;
+      for (k = 0; k < POOL; k++) p->req[k] = MPI_REQUEST_NULL;
+      k = 0, c->next = c->slots, c->slots += POOL;
+    } else {
+      MPI_Wait(&p->req[k], MPI_STATUS_IGNORE);
+    }
+  }
+  c->next = (c->next + 1) % c->slots;
+  *slot = k;
+  return p;
+}
+
+/** Completes every send in the pool, or with block unset tests whether they all have. */
+static int pool_done(elect_ctx_t *c, int block, int *flag) {
+  pool_t *p;
+
+  *flag = 1;
+  for (p = &c->pool; p && *flag; p = p->more) {
+    if (block) CHECK(MPI_Waitall(POOL, p->req, MPI_STATUSES_IGNORE));
+    else CHECK(MPI_Testall(POOL, p->req, flag, MPI_STATUSES_IGNORE));
+  }
+  return MPI_SUCCESS;
+}
+
+static void post_to(elect_run_t r, int dest, int dir, int type, int uid, int rank, int phase, int hops) {
+  elect_ctx_t *c = r->c;
+  int slot;
+  pool_t *p = take_slot(c, &slot);
+  int *m = p->buf[slot];
+
+  m[0] = type, m[1] = dir, m[2] = uid, m[3] = rank, m[4] = phase, m[5] = hops, m[6] = r->depth + 1;
+  MPI_Isend(m, SIZE_MSG, MPI_INT, dest, TAG_ELECTION, c->comm, &p->req[slot]);
+  if (type != FIN) r->local[0]++;
+}
+
+static void post(elect_run_t r, int dir, int type, int uid, int rank, int phase, int hops) {
+  post_to(r, dir == RIGHT ? r->c->right : r->c->left, dir, type, uid, rank, phase, hops);
+}
+
+/** Chord: ELECTED to every child, hops from the decision so far. */
+static void announce_down(elect_run_t r, int hops) {
+  int i;
+  for (i = 0; i < r->c->children; i++)
+    post_to(r, r->c->rank + (1 << i), CHORD, ELECTED, r->leader_uid, r->leader_rank, 0, hops + 1);
+}
+
+/** Chord: every child has reported, so pass the largest key up, or decide at the root. */
+static void report_up(elect_run_t r) {
+  if (r->c->parent >= 0) {
+    post_to(r, r->c->parent, CHORD, PROBE, r->best_uid, r->best_rank, 0, 0);
+    return;
+  }
+  r->leader_uid = r->best_uid, r->leader_rank = r->best_rank;
+  announce_down(r, 0);
+  r->finished = 1;
+}
+
+static void probe_both(elect_run_t r) {
+  post(r, LEFT, PROBE, r->uid, r->c->rank, r->phase, 1);
+  post(r, RIGHT, PROBE, r->uid, r->c->rank, r->phase, 1);
+}
+
+/** This process's key came home: it leads. */
+static void won(elect_run_t r) {
+  if (r->announced) return;
+  r->announced = 1;
+  post(r, RIGHT, ELECTED, r->uid, r->c->rank, 0, 1);
+}
+
+static void handle(elect_run_t r, const int *m) {
+  int type = m[0], dir = m[1], uid = m[2], rank = m[3], phase = m[4], hops = m[5];
+  int mine = uid == r->uid && rank == r->c->rank;
+
+  if (m[6] > r->depth) r->depth = m[6];
+  if (r->algo == ELECT_CHORD) {
+    if (type == PROBE) {
+      if (greater(uid, rank, r->best_uid, r->best_rank)) r->best_uid = uid, r->best_rank = rank;
+      if (++r->replies == r->c->children) report_up(r);
+    } else {
+      r->leader_uid = uid, r->leader_rank = rank, r->announce_depth = hops;
+      announce_down(r, hops);
+      r->finished = 1;
+    }
+    return;
+  }
+
+  switch (type) {
+    case PROBE:
+      if (mine) {
+        won(r);
+      } else if (r->algo == ELECT_LCR) {
+        if (greater(uid, rank, r->best_uid, r->best_rank)) {
+          r->best_uid = uid, r->best_rank = rank;
+          post(r, RIGHT, PROBE, uid, rank, 0, 0);
+        }
+      } else if (greater(uid, rank, r->uid, r->c->rank)) {
+        if (hops < (1ll << phase)) post(r, dir, PROBE, uid, rank, phase, hops + 1);
+        else post(r, !dir, REPLY, uid, rank, phase, 0);
+      }
+      break;
+
+    case REPLY:
+      if (!mine) {
+        post(r, dir, REPLY, uid, rank, phase, 0);
+      } else if (phase == r->phase && ++r->replies == 2) {
+        r->phase++, r->replies = 0;
+        probe_both(r);
+      }
+      break;
+
+    case ELECTED:
+      r->leader_uid = uid, r->leader_rank = rank;
+      if (!mine) post(r, RIGHT, ELECTED, uid, rank, 0, hops + 1);
+      else r->announce_depth = hops - 1;
+      r->finished = 1;
+      break;
+  }
+}
+
+/** Starts summing the counts; also keeps anyone from starting the next run while others drain this one. */
+static int reduce(elect_run_t r) {
+  r->depths[0] = r->depth, r->depths[1] = r->announce_depth;
+  CHECK(MPI_Iallreduce(r->local, r->total, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, r->c->comm, &r->reduce[0]));
+  CHECK(MPI_Iallreduce(r->depths, r->max_depths, 2, MPI_INT, MPI_MAX, r->c->comm, &r->reduce[1]));
+  r->stage = REDUCING;
+  return MPI_SUCCESS;
+}
+
+/**
+ * Moves the run on as far as it can go. With block set it waits for each
+ * message and returns at DONE; without, it returns as soon as nothing is ready.
+ */
+static int progress(elect_run_t r, int block) {
+  elect_ctx_t *c = r->c;
+  int flag;
+
+  while (r->stage == RUNNING || r->stage == DRAINING) {
+    if (block) {
+      CHECK(MPI_Wait(&r->recv, MPI_STATUS_IGNORE));
+    } else {
+      CHECK(MPI_Test(&r->recv, &flag, MPI_STATUS_IGNORE));
+      if (!flag) return MPI_SUCCESS;
+    }
+
+    // A neighbour that is already done may send its FIN before this process is
+    if (r->rbuf[0] == FIN) {
+      r->fins++;
+    } else {
+      r->local[1]++;
+      if (r->stage == RUNNING) handle(r, r->rbuf);
+    }
+
+    // Draining: whatever else arrives before both neighbours' FINs is stale
+    if (r->stage == RUNNING && r->finished) {
+      if (r->algo == ELECT_CHORD) {
+        CHECK(reduce(r)); // nothing more is coming
+        break;
+      }
+      post(r, LEFT, FIN, 0, 0, 0, 0);
+      post(r, RIGHT, FIN, 0, 0, 0, 0);
+      r->stage = DRAINING;
+    }
+    if (r->stage == DRAINING && r->fins == 2) CHECK(reduce(r));
+    else CHECK(MPI_Irecv(r->rbuf, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, TAG_ELECTION, c->comm, &r->recv));
+  }
+
+  if (r->stage == REDUCING) {
+    if (block) {
+      CHECK(MPI_Waitall(2, r->reduce, MPI_STATUSES_IGNORE));
+      CHECK(pool_done(c, 1, &flag));
+    } else {
+      CHECK(MPI_Testall(2, r->reduce, &flag, MPI_STATUSES_IGNORE));
+      if (!flag) return MPI_SUCCESS;
+      CHECK(pool_done(c, 0, &flag));
+      if (!flag) return MPI_SUCCESS;
+    }
+
+    elect_result_t *res = r->result;
+    res->leader_rank = r->leader_rank, res->leader_uid = r->leader_uid;
+    res->is_leader = r->leader_rank == c->rank;
+    res->msgs_sent = r->total[0], res->msgs_rcvd = r->total[1];
+    res->local_sent = r->local[0], res->local_rcvd = r->local[1];
+    res->depth = r->max_depths[0], res->announce_depth = r->max_depths[1];
+    r->stage = DONE;
+  }
+  return MPI_SUCCESS;
+}
+
+/** Posts the receive and this process's first messages. */
+static int begin(elect_run_t r) {
+  elect_ctx_t *c = r->c;
+
+  if (c->size == 1) return reduce(r);
+  CHECK(MPI_Irecv(r->rbuf, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, TAG_ELECTION, c->comm, &r->recv));
+  if (r->algo == ELECT_HS) probe_both(r);
+  else if (r->algo == ELECT_LCR) post(r, RIGHT, PROBE, r->uid, c->rank, 0, 0);
+  else if (!c->children) report_up(r);
+  return MPI_SUCCESS;
+}
+
+static void *progress_thread(void *arg) {
+  elect_run_t r = arg;
+  r->rc = begin(r);
+  if (r->rc == MPI_SUCCESS) r->rc = progress(r, 1);
+  __atomic_store_n(&r->complete, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+int elect_start(MPI_Comm comm, elect_algo_t algorithm, const elect_options_t *options, elect_result_t *result,
+                elect_run_t *handle) {
+  elect_ctx_t *c;
+  elect_run_t r;
+  int provided;
+
+  if (algorithm != ELECT_HS && algorithm != ELECT_LCR && algorithm != ELECT_CHORD) return MPI_ERR_ARG;
+  if (options && options->progress_thread) {
+    MPI_Query_thread(&provided);
+    if (provided != MPI_THREAD_MULTIPLE) return MPI_ERR_OTHER;
+  }
+  CHECK(get_ctx(comm, &c));
+  r = &c->run;
+  if (r->stage != IDLE) return MPI_ERR_OTHER;
+
+  memset(r, 0, sizeof(*r));
+  r->c = c, r->algo = algorithm, r->result = result;
+  r->uid = options ? options->uid : c->rank;
+  r->best_uid = r->uid, r->best_rank = c->rank;
+  r->leader_uid = r->uid, r->leader_rank = c->rank;
+  r->recv = r->reduce[0] = r->reduce[1] = MPI_REQUEST_NULL;
+  r->stage = RUNNING; // begin() may move a run of one process straight on to REDUCING
+  *handle = r;
+
+  // A progress thread posts the first messages itself, so if it can't be
+  // started nothing is in flight and the communicator is free for another run
+  if (options && options->progress_thread) {
+    if (pthread_create(&r->thread, NULL, progress_thread, r)) return finish(r, MPI_ERR_OTHER);
+    r->threaded = 1;
+    return MPI_SUCCESS;
+  }
+  return finish(r, begin(r));
+}
+
+int elect_test(elect_run_t handle, int *done) {
+  int rc;
+
+  if (handle->threaded) {
+    if (!__atomic_load_n(&handle->complete, __ATOMIC_ACQUIRE)) {
+      *done = 0;
+      return MPI_SUCCESS;
+    }
+    pthread_join(handle->thread, NULL);
+    handle->threaded = 0, rc = handle->rc;
+  } else {
+    rc = progress(handle, 0);
+  }
+  *done = handle->stage == DONE || rc != MPI_SUCCESS;
+  return finish(handle, rc);
+}
+
+int elect_wait(elect_run_t handle) {
+  int rc;
+
+  if (handle->threaded) {
+    pthread_join(handle->thread, NULL);
+    handle->threaded = 0, rc = handle->rc;
+  } else {
+    rc = progress(handle, 1);
+  }
+  return finish(handle, rc);
+}
+
+int elect_leader(MPI_Comm comm, elect_algo_t algorithm, const elect_options_t *options, elect_result_t *result) {
+  elect_run_t r;
+  CHECK(elect_start(comm, algorithm, options, result, &r));
+  return elect_wait(r);
+}
+
+const char *elect_algo_name(elect_algo_t algorithm) {
+  return names[algorithm];
+}
+
+int elect_algo_parse(const char *str, elect_algo_t *algorithm) {
+  int i;
+  for (i = ELECT_HS; i <= ELECT_CHORD; i++)
+    if (!strcmp(str, names[i])) {
+      *algorithm = (elect_algo_t) i;
+      return 0;
+    }
+  return -1;
+}
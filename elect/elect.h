@@ -0,0 +1,88 @@
+/**
+ * elect.h
+ *
+ * Leader election as a library call, for applications that want a leader on
+ * some communicator without launching one of the election programs:
+ *
+ *   elect_result_t r;
+ *   elect_leader(comm, ELECT_HS, NULL, &r);
+ *
+ * Every process of comm must call it. The processes form a ring in rank order
+ * and run Hirschberg-Sinclair or LeLann/Chang-Roberts over it, or a chordal
+ * ring election that also uses links to the ranks 2^i away; every process
+ * gets the leader's rank and uid, and the message totals and hop depths of
+ * the whole run.
+ *
+ * The first call on a communicator duplicates it and caches the duplicate,
+ * with the message buffers, as an attribute of comm, so the election's
+ * messages can never match the application's and later calls on the same
+ * communicator allocate nothing, unless a run has more sends in flight at
+ * once than any before it (the buffers then grow by 64 rather than wait, so
+ * elect_test() never blocks). The cache goes away when comm is freed.
+ * Each call returns only after every message it sent has been received, so
+ * calls on the same communicator can follow each other directly.
+ *
+ * elect_start() begins the same election and returns at once, so the caller
+ * can keep computing; elect_test() moves it on without blocking and says
+ * whether it is over, and elect_wait() blocks until it is, like MPI_Test and
+ * MPI_Wait on a request. The election only advances inside those calls,
+ * unless options ask for a progress thread, which needs MPI_THREAD_MULTIPLE
+ * (and so a real MPI, not FG-MPI's co-located processes). A communicator can
+ * have one election running at a time.
+ */
+
+#ifndef ELECT_H
+#define ELECT_H
+
+#include <mpi.h>
+
+typedef enum { ELECT_HS, ELECT_LCR, ELECT_CHORD } elect_algo_t;
+
+typedef struct {
+  int uid;              // this process's uid; equal uids are ordered by rank
+  int progress_thread;  // elect_start: drive the election from a thread of its own
+} elect_options_t;
+
+typedef struct elect_run *elect_run_t;
+
+typedef struct {
+  int leader_rank;                 // rank in comm
+  int leader_uid;
+  int is_leader;
+  unsigned long long msgs_sent;    // election messages over all of comm
+  unsigned long long msgs_rcvd;
+  unsigned long long local_sent;   // this process's share
+  unsigned long long local_rcvd;
+  int depth;                       // longest chain of messages, each sent on receiving the one before
+  int announce_depth;              // hops from the decision to the last process told the leader
+} elect_result_t;
+
+/**
+ * Collective over comm. options may be NULL, in which case every process's uid
+ * is its rank. Returns MPI_SUCCESS, MPI_ERR_ARG for an unknown algorithm, or
+ * the error of the MPI call that failed.
+ */
+int elect_leader(MPI_Comm comm, elect_algo_t algorithm, const elect_options_t *options, elect_result_t *result);
+
+/**
+ * Non-blocking elect_leader(). *result is filled in by the elect_test() that
+ * reports done, or by elect_wait(), and must stay valid until then. Returns as
+ * elect_leader() does, and MPI_ERR_OTHER if an election is already running on
+ * comm, or a progress thread was asked for without MPI_THREAD_MULTIPLE or
+ * could not be started. After an error the handle is not valid and comm is
+ * free for another run, though the other processes' runs can't complete.
+ */
+int elect_start(MPI_Comm comm, elect_algo_t algorithm, const elect_options_t *options, elect_result_t *result,
+                elect_run_t *handle);
+
+/** Sets *done to 1 once the election is over; the handle is spent then. */
+int elect_test(elect_run_t handle, int *done);
+
+/** Blocks until the election is over; the handle is spent then. */
+int elect_wait(elect_run_t handle);
+
+/** "hs", "lcr" or "chord"; elect_algo_parse returns -1 for anything else. */
+const char *elect_algo_name(elect_algo_t algorithm);
+int elect_algo_parse(const char *str, elect_algo_t *algorithm);
+
+#endif
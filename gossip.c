@@ -0,0 +1,240 @@
+/**
+ * gossip.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./gossip [ -e <quiet rounds> | -R <rounds> ] [ -r <trials> ] [ -u <uid distribution> ] [ -s <seed> ]
+ * (uids are random unless -u says otherwise, as in hs.c)
+ *
+ * Push-pull gossip election: the largest uid spreads like a rumour instead of
+ * round a ring. Every round each process picks a peer uniformly at random,
+ * pushes its max_so_far to it and pulls the peer's back, so a value known to
+ * one process reaches all of them in O(log n) rounds with high probability,
+ * at 2n messages a round.
+ *
+ * A round ends when every process has had its reply and every push it was sent
+ * has been answered: pushes go out with MPI_Issend, and once a process's push
+ * has been matched and its reply has arrived it joins a nonblocking
+ * MPI_Iallreduce, answering pushes until the reduction completes (the NBX
+ * pattern). The reduction also carries the stopping rule:
+ *   -e E  stop once no process's max_so_far changed in the last E rounds
+ *         (default 3)
+ *   -R R  stop after exactly R rounds
+ * Either can stop before the largest uid has reached everyone. Each process
+ * then takes itself to lead if max_so_far is its own uid.
+ *
+ * The election is run <trials> times (default 20) on the same uids with fresh
+ * peers. Only to score it, the true maximum comes from MPI_Allreduce. Rank 0
+ * prints the mean and largest rounds until every process held the maximum,
+ * the mean rounds until the rule stopped the run, messages per trial and the
+ * fraction of trials that ended with some process on a wrong leader. The
+ * round reductions are not counted as messages.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+
+// Tags; a round's pushes and pulls use the tag plus its parity, since a
+// process that is already out of round r can push for round r+1
+#define TAG_PUSH 2
+#define TAG_PULL 4
+
+#define SIZE_MSG 2
+
+// Per-trial values summed on rank 0
+enum { T_WRONG, T_MSGS, T_COUNT };
+
+/** FG-MPI Boilerplate begins **/
+int gossip(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&gossip);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+/** A peer other than rank, uniformly. */
+static int pick_peer(int rank, int size, unsigned *state) {
+  int p = rand_r(state) % (size - 1);
+  return p >= rank ? p + 1 : p;
+}
+
+/**
+ * One push-pull round. Pushes max_so_far to a random peer and answers every
+ * push that arrives until the round's reduction completes. Returns whether any
+ * process had changed, i.e. passed recent in or has a new max_so_far by the
+ * time it joined the reduction. *sent and *rcvd count messages.
+ */
+static int round_trip(int *max_so_far, int recent, int round, int rank, int size, unsigned *state,
+                      int *sent, int *rcvd, MPI_Comm comm) {
+  int push[SIZE_MSG] = { *max_so_far, round }, pull[SIZE_MSG], in[SIZE_MSG], reply[SIZE_MSG];
+  int peer = pick_peer(rank, size, state), parity = round & 1, any = 0, entered = 0, done = 0;
+  int push_done = 0, pull_done = 0, changed, flag;
+  MPI_Request req[3];
+  MPI_Status status;
+
+  // The reply is received into a posted buffer, so the peer's MPI_Send can't block
+  MPI_Irecv(pull, SIZE_MSG, MPI_INT, peer, TAG_PULL + parity, comm, &req[1]);
+  MPI_Issend(push, SIZE_MSG, MPI_INT, peer, TAG_PUSH + parity, comm, &req[0]);
+  (*sent)++;
+
+  while (!done) {
+    int progress = 0;
+
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_PUSH + parity, comm, &flag, &status);
+    if (flag) {
+      MPI_Recv(in, SIZE_MSG, MPI_INT, status.MPI_SOURCE, TAG_PUSH + parity, comm, MPI_STATUS_IGNORE);
+      reply[0] = *max_so_far, reply[1] = round;
+      MPI_Send(reply, SIZE_MSG, MPI_INT, status.MPI_SOURCE, TAG_PULL + parity, comm);
+      if (in[0] > *max_so_far) *max_so_far = in[0];
+      (*rcvd)++, (*sent)++;
+      progress = 1;
+    }
+    if (!push_done) {
+      MPI_Test(&req[0], &push_done, MPI_STATUS_IGNORE);
+      progress |= push_done;
+    }
+    if (!pull_done) {
+      MPI_Test(&req[1], &pull_done, MPI_STATUS_IGNORE);
+      if (pull_done) {
+        if (pull[0] > *max_so_far) *max_so_far = pull[0];
+        (*rcvd)++;
+        progress = 1;
+      }
+    }
+    if (push_done && pull_done && !entered) {
+      changed = recent || *max_so_far != push[0];
+      MPI_Iallreduce(&changed, &any, 1, MPI_INT, MPI_LOR, comm, &req[2]);
+      entered = 1;
+    }
+    if (entered) MPI_Test(&req[2], &done, MPI_STATUS_IGNORE);
+    if (!progress && !done) MPIX_Yield();
+  }
+
+  return any;
+}
+
+int gossip(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  int quiet = 3, rounds = 0, trials = 20;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-e")) {
+      quiet = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-R")) {
+      rounds = atoi(argv[2]);
+    } else if (!strcmp(argv[1], "-r")) {
+      trials = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 1 || quiet < 1 || rounds < 0 || trials < 1 || opts.stats_path || opts.timing) {
+    printf("Usage: ./gossip [ -e <quiet rounds> | -R <rounds> ] [ -r <trials> ] [ -u <uid distribution> ] [ -s <seed> ]\n");
+    exit(1);
+  }
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (size < 2) {
+    printf("Usage: gossip needs at least 2 processes\n");
+    exit(1);
+  }
+
+  int pnum = size * 1000000 + 1;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
+
+  // rand() is shared by co-located processes, so peers come from a private
+  // state, and a seeded run picks the same peers every time
+  unsigned state = (opts.seed < 0 ? (unsigned) time(NULL) : (unsigned) opts.seed) * 2654435761u + rank;
+
+  int true_max, t, log_n = 0;
+  while ((1 << log_n) < size) log_n++;
+  MPI_Allreduce(&uid, &true_max, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+  MPI_Comm comm;
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+  // Over all trials, on rank 0
+  double sum_converge = 0, sum_stop = 0, sum_msgs = 0, sum_wrong = 0, sum_seconds = 0;
+  int max_converge = 0, wrong_trials = 0, unconverged = 0;
+  int first_sent = 0, first_rcvd = 0, first_leader = 0;
+
+  for (t = 0; t < trials; t++) {
+    int max_so_far = uid, sent = 0, rcvd = 0, r = 0, last_change = 0, prev, any;
+    int learned = uid == true_max ? 0 : -1;
+
+    MPI_Barrier(comm);
+    double t_start = MPI_Wtime(), elapsed;
+    do {
+      prev = max_so_far;
+      r++;
+      // Quiet: no change in this round or the quiet - 1 before it
+      any = round_trip(&max_so_far, r - last_change < quiet, r, rank, size, &state, &sent, &rcvd, comm);
+      if (max_so_far != prev) last_change = r;
+      if (learned < 0 && max_so_far == true_max) learned = r;
+    } while (rounds ? r < rounds : any);
+    elapsed = MPI_Wtime() - t_start;
+
+    // -learned is positive somewhere if a process never learned the maximum
+    long long local[T_COUNT] = { max_so_far != true_max, sent }, total[T_COUNT];
+    int minmax[2] = { -learned, learned }, tminmax[2], is_leader = (max_so_far == uid);
+    MPI_Reduce(local, total, T_COUNT, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(minmax, tminmax, 2, MPI_INT, MPI_MAX, 0, comm);
+    MPI_Reduce(rank ? &elapsed : MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+    if (!t) {
+      first_sent = sent, first_rcvd = rcvd, first_leader = is_leader;
+    }
+
+    if (!rank) {
+      if (tminmax[0] > 0) unconverged++;
+      else {
+        sum_converge += tminmax[1];
+        if (tminmax[1] > max_converge) max_converge = tminmax[1];
+      }
+      sum_stop += r, sum_msgs += total[T_MSGS], sum_wrong += total[T_WRONG], sum_seconds += elapsed;
+      if (total[T_WRONG]) wrong_trials++;
+    }
+  }
+
+  // The first trial's totals, on the Leader line like the ring programs
+  int mine[2] = { first_rcvd, first_sent }, firsts[2];
+  MPI_Allreduce(mine, firsts, 2, MPI_INT, MPI_SUM, comm);
+  if (first_leader && uid == true_max) {
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, uid, firsts[0], firsts[1], uid_name(&opts.uids));
+  }
+
+  if (!rank) {
+    int converged = trials - unconverged;
+    printf("Gossip: n=%d, log2_n=%d, trials=%d, stop=%s:%d, rounds_to_converge=%.2f (max %d, %d never), "
+           "rounds_to_stop=%.2f, msgs_per_trial=%.1f, p_wrong_leader=%.4f, wrong_per_trial=%.2f, seconds_per_trial=%.6f\n",
+           size, log_n, trials, rounds ? "rounds" : "quiet", rounds ? rounds : quiet,
+           converged ? sum_converge / converged : 0, max_converge, unconverged, sum_stop / trials, sum_msgs / trials,
+           (double) wrong_trials / trials, sum_wrong / trials, sum_seconds / trials);
+  }
+
+  MPI_Comm_free(&comm);
+  MPI_Finalize();
+  return 0;
+}
@@ -8,6 +8,11 @@
  * An implementation of Hirschberg-Sinclair's algorithm with 
  * randomly-selected nodes regalated to behave as pass-through-only
  * nodes, and only one initiator to begin with.
+ *
+ * Pass-through nodes are picked from rank and seed (common/passthru.h), so
+ * binding_func binds them to hs_forward, which keeps no election state and
+ * only relays, unless -v, -o or -t need every rank in the election's
+ * collectives. -m prints the stack and resident memory of both kinds.
  * 
  */
 
@@ -18,6 +23,12 @@
 #include <time.h>
 #include <mpi.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "passthru.h"
+#include "mem.h"
 
 
 // Tags
@@ -35,8 +46,13 @@ int gcd(int size, int pnum);
 
 /** FG-MPI Boilerplate begins **/
 int hs_passthru(int argc, char* argv[]);
+int hs_forward(int argc, char* argv[]);
 
 FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  if (opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY) == 2 && !opts.stats_path && !opts.timing && passthru_rank(rank, opts.uids.seed))
+    return (&hs_forward);
   return (&hs_passthru);
 }
 
@@ -55,18 +71,24 @@ int main(int argc, char *argv[]) {
 
 int hs_passthru(int argc, char *argv[]) {
 
- if (argc != 2 && argc != 3) {
-    printf("Usage: ./hs [ -v ] <Process number>\n");
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+ if ((argc != 2 && argc != 3) || (argc == 3 && strcmp(argv[1], "-v") && strcmp(argv[2], "-v"))) {
+    printf("Usage: ./hs [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE " <Process number>\n");
     exit(1);
   }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
 
 
   int lnum_sent = 0, lnum_recv = 0;
   int tnum_sent = 0, tnum_recv = 0;
-  int pnum;
+  int pnum = 0;
 
-  int rank, size;
-  MPI_Init (&argc, &argv);  
+  int rank, size, initialized;
+  MPI_Initialized(&initialized);
+  if (!initialized) MPI_Init (&argc, &argv);  // hs_forward hands the initiator over initialized
+  double t_start = MPI_Wtime();
   MPI_Comm_rank (MPI_COMM_WORLD, &rank);  // my pid
   MPI_Comm_size (MPI_COMM_WORLD, &size);  // number of processes 
   MPI_Status status;
@@ -78,6 +100,7 @@ int hs_passthru(int argc, char *argv[]) {
     else if (!strcmp(argv[2], "-v")) pnum = atoi(argv[1]),  verbose = 1;
   } else if (argc == 2) 
     pnum = atoi(argv[1]);
+  if (opts.stats_path) verbose = 1;
  
 
   if (pnum <= size || gcd(size, pnum) != 1) {
@@ -87,9 +110,9 @@ int hs_passthru(int argc, char *argv[]) {
 
 
   int election_sendbuf[SIZE_MSG];
-  srand(time(NULL) + rank);
- // int uid = (rand() % pnum);
-  int uid = ((rank+1)*pnum) % size;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_ARITH;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
  
   int max_so_far = uid;
   int k = 0, d = 0;
@@ -107,10 +130,14 @@ int hs_passthru(int argc, char *argv[]) {
 
   int last = ceiling_log2((unsigned long long) size);
 
+  timing_t tm;
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
   int initiator =  (uid % size) == (size - 1)/2; 
   int participant = 0;
-  int rnd = rand() % size;
-  int canParticipate = (rnd % 5);
+  int canParticipate = !passthru_rank(rank, opts.uids.seed);
 
 
   if (initiator) {
@@ -128,6 +155,7 @@ int hs_passthru(int argc, char *argv[]) {
     MPI_Recv(recvbuf, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
     lnum_recv++;
     k = recvbuf[1], d = recvbuf[2];
+    timing_phase(&tm, k);
     if (status.MPI_TAG == TAG_IGNORE) {
       if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
       break;
@@ -263,8 +291,11 @@ int hs_passthru(int argc, char *argv[]) {
   MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, left, TAG_IGNORE, MPI_COMM_WORLD, &request);
   MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_IGNORE, MPI_COMM_WORLD, &request);
 
-   if (participant && verbose) 
-    printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, (max_so_far == uid), lnum_recv, lnum_sent);
+  if (max_so_far == uid) timing_leader(&tm);
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = uid, .leader = (max_so_far == uid), .initiator = initiator,
+                         .participant = participant, .mrcvd = lnum_recv, .msent = lnum_sent, .phase = k,
+                         .elapsed = MPI_Wtime() - t_start };
 
   if (max_so_far == uid) {
       msgBuf[0] = lnum_recv, msgBuf[1] = lnum_sent+1, msgBuf[2] = uid;
@@ -274,8 +305,8 @@ int hs_passthru(int argc, char *argv[]) {
      // Non-leaders, do a receive and a send for their message totals as well
       MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status);
       // increase its count by 1 for each receive and send
-      msgBuf[0] = msgRecv[0]+ lnum_recv, msgBuf[1] = msgRecv[1]+ lnum_sent;
-      max_so_far = msgBuf[2];
+      msgBuf[0] = msgRecv[0]+ lnum_recv, msgBuf[1] = msgRecv[1]+ lnum_sent, msgBuf[2] = msgRecv[2];
+      max_so_far = msgBuf[2]; // the leader's uid, so a uid of 0 doesn't wait for the totals as well
       if (participant) MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request); 
       else MPI_Isend(msgRecv, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request);
   }
@@ -285,9 +316,80 @@ int hs_passthru(int argc, char *argv[]) {
     MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status); 
     tnum_recv = msgRecv[0];
     tnum_sent = msgRecv[1];
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
+  }
+
+  timing_report(&tm, max_so_far == uid && participant, "phase");
+  load_report(&opts.uids, uid, max_so_far == uid && participant ? uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) passthru_mem_report(0, mem_stack_mark(0, MEM_STACK_PAINT, &opts), MPI_COMM_WORLD);
+
+  MPI_Finalize();
+  return 0;
+}
+
+/**
+ * A pass-through rank with nothing but the relay: every message goes on to
+ * the other neighbour until TAG_IGNORE arrives or the phase passes the last,
+ * then the same IGNORE and message-total sends as a pass-through
+ * hs_passthru, so the run is message for message the same.
+ */
+int hs_forward(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  int orig_argc = argc;
+  char **orig_argv = argv;
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // The initiator always takes part, even when it is picked to pass through
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_ARITH;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
+  if ((uid % size) == (size - 1)/2) return hs_passthru(orig_argc, orig_argv);
+
+  int left = (rank + size - 1) % size, right = (rank + 1) % size;
+  int last = ceiling_log2((unsigned long long) size);
+  int buf[2][SIZE_MSG], cur = 0, k = 0, max_so_far = uid, lnum_recv = 0;
+  MPI_Request request[4] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+  MPI_Status status;
+
+  // Two buffers, so one can be received into while the other is still going out
+  while (k < last+1) {
+    MPI_Wait(&request[cur], MPI_STATUS_IGNORE);
+    MPI_Recv(buf[cur], SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+    lnum_recv++;
+    k = buf[cur][1];
+    if (status.MPI_TAG == TAG_IGNORE) {
+      if (buf[cur][0] > max_so_far) max_so_far = buf[cur][0];
+      break;
+    }
+    MPI_Isend(buf[cur], SIZE_MSG, MPI_INT, status.MPI_SOURCE == left ? right : left, status.MPI_TAG, MPI_COMM_WORLD,
+              &request[cur]);
+    cur ^= 1;
+  }
+
+  int msgBuf[SIZE_MSG] = { max_so_far, 0, 0 }, msgRecv[SIZE_MSG];
+  MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, left, TAG_IGNORE, MPI_COMM_WORLD, &request[2]);
+  MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_IGNORE, MPI_COMM_WORLD, &request[3]);
+  MPI_Waitall(4, request, MPI_STATUSES_IGNORE);
+
+  if (max_so_far == uid) {
+    msgRecv[0] = lnum_recv, msgRecv[1] = 1, msgRecv[2] = uid;
+  } else {
+    MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status);
   }
+  MPI_Send(msgRecv, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD);
 
+  load_report(&opts.uids, uid, -1, size, MPI_COMM_WORLD);
+  if (opts.memory) passthru_mem_report(1, mem_stack_mark(0, MEM_STACK_PAINT, &opts), MPI_COMM_WORLD);
   MPI_Finalize();
   return 0;
 }
@@ -16,6 +16,11 @@
 #include <time.h>
 #include <mpi.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "mem.h"
 
 
 // Tags
@@ -55,15 +60,19 @@ int main(int argc, char *argv[]) {
 
 int hs_random(int argc, char *argv[]) {
 
- if (argc != 2 && argc != 3) {
-    printf("Usage: ./hs-random [ -v ] <Process number>\n");
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+ if ((argc != 2 && argc != 3) || (argc == 3 && strcmp(argv[1], "-v") && strcmp(argv[2], "-v"))) {
+    printf("Usage: ./hs-random [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE " <Process number>\n");
     exit(1);
   }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
 
 
   int lnum_sent = 0, lnum_recv = 0;
   int tnum_sent = 0, tnum_recv = 0;
-  int pnum;
+  int pnum = 0;
 
   int verbose = 0;
   if (argc == 3) {
@@ -71,10 +80,12 @@ int hs_random(int argc, char *argv[]) {
     else if (!strcmp(argv[2], "-v")) pnum = atoi(argv[1]),  verbose = 1;
   } else if (argc == 2) 
     pnum = atoi(argv[1]);
+  if (opts.stats_path) verbose = 1;
  
 
   int rank, size;
   MPI_Init (&argc, &argv); 
+  double t_start = MPI_Wtime();
   MPI_Comm_rank (MPI_COMM_WORLD, &rank);  // get my pid
   MPI_Comm_size (MPI_COMM_WORLD, &size);  // get number of processes 
   MPI_Status status;
@@ -86,9 +97,9 @@ int hs_random(int argc, char *argv[]) {
   }
 
   int election_sendbuf[SIZE_MSG];
-  srand(time(NULL) + rank);
-  int uid = (rand() % pnum);
-//  int uid = ((rank+1)*pnum) % size;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
  
   int max_so_far = uid;
   int k = 0, d = 0;
@@ -106,12 +117,16 @@ int hs_random(int argc, char *argv[]) {
 
   int last = ceiling_log2((unsigned long long) size);
 
+  timing_t tm;
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
   int initiator = (((rand()+uid) % size) > (size - 1)/2);
   int participant = 0;
 
   if (initiator) {
     participant = 1;
-    if (verbose) printf("Process %d is an initiator\n", rank);
     MPI_Isend(election_sendbuf, SIZE_MSG, MPI_INT, left, TAG_ELECTION, MPI_COMM_WORLD, &request);
     MPI_Isend(election_sendbuf, SIZE_MSG, MPI_INT, right, TAG_ELECTION, MPI_COMM_WORLD, &request);
     lnum_sent+= 2;
@@ -123,6 +138,7 @@ int hs_random(int argc, char *argv[]) {
     MPI_Recv(recvbuf, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
     lnum_recv++;
     k = recvbuf[1], d = recvbuf[2];
+    timing_phase(&tm, k);
     if (status.MPI_TAG == TAG_IGNORE) {
       if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
       break;
@@ -252,8 +268,11 @@ int hs_random(int argc, char *argv[]) {
    MPI_Request_free(&request);
  
 
-  if (participant && verbose) 
-    printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, (max_so_far == uid), lnum_recv, lnum_sent);
+  if (max_so_far == uid) timing_leader(&tm);
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = uid, .leader = (max_so_far == uid), .initiator = initiator,
+                         .participant = participant, .mrcvd = lnum_recv, .msent = lnum_sent, .phase = k,
+                         .elapsed = MPI_Wtime() - t_start };
 
   if (max_so_far == uid) {
       msgBuf[0] = lnum_recv, msgBuf[1] = lnum_sent, msgBuf[2] = uid;
@@ -263,8 +282,8 @@ int hs_random(int argc, char *argv[]) {
      // Non-leaders, do a receive and a send for their message totals as well
       MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status);
       // increase its count by 1 for each receive and send
-      msgBuf[0] = msgRecv[0]+ lnum_recv, msgBuf[1] = msgRecv[1]+ lnum_sent;
-      max_so_far = msgBuf[2];
+      msgBuf[0] = msgRecv[0]+ lnum_recv, msgBuf[1] = msgRecv[1]+ lnum_sent, msgBuf[2] = msgRecv[2];
+      max_so_far = msgBuf[2]; // the leader's uid, so a uid of 0 doesn't wait for the totals as well
       if (participant) MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request); 
       else MPI_Isend(msgRecv, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request);
   }
@@ -274,9 +293,14 @@ int hs_random(int argc, char *argv[]) {
     MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status); 
     tnum_recv = msgRecv[0];
     tnum_sent = msgRecv[1];
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
   }
 
+  timing_report(&tm, max_so_far == uid, "phase");
+  load_report(&opts.uids, uid, max_so_far == uid ? uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) mem_report(mem_stack_mark(0, MEM_STACK_PAINT, &opts), 0, MPI_COMM_WORLD);
+
 
 
   MPI_Finalize();
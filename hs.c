@@ -7,7 +7,8 @@
  * March 15, 2014
  *
  * Usage:
- * mpiexec -n <N PROCESSES> ./hs [ 1 ] for randomly assigned uids
+ * mpiexec -n <N PROCESSES> ./hs [ -b ring|tree|ibcast ] [ -w block|poll[:<tests>]|spin ] [ -c <batch>[:<polls>] ] [ -p ] [ -v ] [ -o <stats file> ] [ -u <uid distribution> ] [ -s <seed> ]
+ * (uids are random unless -u says otherwise)
  *
  * An implementation of Hirschberg-Sinclair's algorithm
  * for asynchronous ring leader election. Improvements on the HS algorithm are 
@@ -39,6 +40,23 @@
  * the final round of message totals), which is 8n*(ceiling{log n}) + n \in O(n log n)
  *
  * The program checks if pnum is relatively coprime to and larger than size.
+ *
+ * -b picks how the leader is announced (common/announce.h). ring, the default,
+ * is the TAG_IGNORE flood, n/2 hops after the winner's last phase; with tree or
+ * ibcast the winner announces itself when its own message first comes back
+ * round the ring, in O(log n) hops, and the totals lap moves to a communicator
+ * of its own so it can't overtake the announcement.
+ *
+ * -w picks how the election loop waits for a message (common/recv.h) and
+ * prints its CPU time, context switches and latency.
+ *
+ * -p prints how the messages and the waiting spread over OS processes and
+ * nodes, and the busiest of them (common/hotspot.h).
+ *
+ * -c batches the election messages to each neighbour, up to <batch> in one
+ * MPI message, sending them when the process runs out of input; <polls> more
+ * probes, yielding in between, give input a chance to come in first
+ * (common/coalesce.h).
  * 
  */
 
@@ -49,6 +67,15 @@
 #include <time.h>
 #include <mpi.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "announce.h"
+#include "mem.h"
+#include "recv.h"
+#include "hotspot.h"
+#include "coalesce.h"
 
 
 // Tags
@@ -58,8 +85,25 @@
 #define TAG_DUMMY 5
 #define TAG_IGNORE 6
 
+// Election tags for -p
+static const char *const tag_names[HOTSPOT_TAGS] = { [TAG_ELECTION] = "election", [TAG_REPLY] = "reply", [TAG_IGNORE] = "ignore" };
+
 #define SIZE_MSG 3
 
+// Message buffers: own probes (then the totals), the message being handled,
+// and what is relayed on each side
+enum { BUF_PROBE, BUF_RECV, BUF_LEFT, BUF_RIGHT, BUFS };
+
+// Everything an HS process keeps during the election, in one place for -m
+typedef struct {
+  int uid, max_so_far;
+  int left, right;
+  int k, d, last;             // phase, hops of the message being handled, last phase
+  int lnum_sent, lnum_recv;
+  int buf[BUFS][SIZE_MSG];
+  int replies[2][2];          // last reply from the left and the right: uid, phase
+} hs_state_t;
+
 int ceiling_log2(unsigned long long x);
 int gcd(int size, int pnum);
 
@@ -84,96 +128,146 @@ int main(int argc, char *argv[]) {
 
 int hs(int argc, char *argv[]) {
 
-  int lnum_sent = 0, lnum_recv = 0;
   int tnum_sent = 0, tnum_recv = 0;
 
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  announce_mode_t mode = ANNOUNCE_RING;
+  recv_t rs;
+  int recv_shown = 0;
+  recv_parse("block", &rs);
+  coalesce_t *coal = NULL;
+  int verbose = 0;
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY | OPTS_PLACEMENT), argv = args;
+  while (argc > 1) {
+    if (!strcmp(argv[1], "-v")) {
+      verbose = 1, argv++, argc--;
+      continue;
+    }
+    if (argc < 3) break;
+    if (!strcmp(argv[1], "-b")) {
+      if (announce_parse(argv[2], &mode)) break;
+    } else if (!strcmp(argv[1], "-w")) {
+      if (recv_parse(argv[2], &rs)) break;
+      recv_shown = 1;
+    } else if (!strcmp(argv[1], "-c")) {
+      if (coalesce_parse(argv[2], &coal)) break;
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 1) {
+    printf("Usage: ./hs [ -b ring|tree|ibcast ] [ -w block|poll[:<tests>]|spin ] [ -c <batch>[:<polls>] ] " OPTS_USAGE_PLACEMENT " [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE "\n");
+    exit(1);
+  }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
+
   int rank, size;
   MPI_Init (&argc, &argv);  
+  double t_start = MPI_Wtime();
   MPI_Comm_rank (MPI_COMM_WORLD, &rank);  // get my pid
   MPI_Comm_size (MPI_COMM_WORLD, &size);  // get number of processes 
   MPI_Status status;
   MPI_Request request;
   
-  int verbose = 0;
-  if (argc == 2 && !strcmp(argv[1], "-v")) verbose = 1;
+  if (opts.stats_path) verbose = 1;
 
   int pnum = size * 1000000 + 1;
 
-  int election_sendbuf[SIZE_MSG];
-  srand(time(NULL) + rank);
-  //int uid = ((rank+1)*pnum) % size;
-  int uid = (rand() % pnum);
- 
-  int max_so_far = uid;
-  int k = 0, d = 0;
-  election_sendbuf[0] = uid, election_sendbuf[1] = k, election_sendbuf[2] = d;
-  int left = rank-1;
-  if (!rank) left = size-1;
-  int right = (rank+1)%size;
-  int recvbuf[SIZE_MSG];
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  hs_state_t st = { .uid = uid_generate(&opts.uids, rank, size, pnum) };
+  st.max_so_far = st.uid;
+  st.left = rank ? rank - 1 : size - 1, st.right = (rank + 1) % size;
+  st.last = ceiling_log2((unsigned long long) size);
+
+  int *election_sendbuf = st.buf[BUF_PROBE], *recvbuf = st.buf[BUF_RECV];
+  int *left_sendbuf = st.buf[BUF_LEFT], *right_sendbuf = st.buf[BUF_RIGHT];
+  election_sendbuf[0] = left_sendbuf[0] = right_sendbuf[0] = st.uid;
   int left_recv_tag, right_recv_tag;
   int endLoopFlag = 0;
-  int recvReplies[2][2] = {{0, 0}, {0, 0}}; // left, right; j, k
-
-  int left_sendbuf[SIZE_MSG] = { max_so_far, k, d }, left_send_tag = TAG_ELECTION, left_send_dest = right;
-  int right_sendbuf[SIZE_MSG] = { max_so_far, k, d }, right_send_tag = TAG_ELECTION, right_send_dest = left;
-
-  int last = ceiling_log2((unsigned long long) size);
-
-  MPI_Isend(election_sendbuf, SIZE_MSG, MPI_INT, left, TAG_ELECTION, MPI_COMM_WORLD, &request);
-  MPI_Isend(election_sendbuf, SIZE_MSG, MPI_INT, right, TAG_ELECTION, MPI_COMM_WORLD, &request);
-  lnum_sent+= 2;
+  int left_send_tag = TAG_ELECTION, left_send_dest = st.right;
+  int right_send_tag = TAG_ELECTION, right_send_dest = st.left;
+
+  MPI_Comm lap = MPI_COMM_WORLD;
+  if (mode != ANNOUNCE_RING) MPI_Comm_dup(MPI_COMM_WORLD, &lap);
+
+  timing_t tm;
+  announce_t ann;
+  hotspot_t hot = { { 0 } };
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  announce_init(&ann, mode, &rs, MPI_COMM_WORLD);
+  rs.timed = opts.placement; // only -p reports the time spent waiting
+  recv_start(&rs);
+  if (coal) coalesce_init(coal, st.left, st.right, MPI_COMM_WORLD);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
+  coalesce_send(coal, election_sendbuf, st.left, TAG_ELECTION, MPI_COMM_WORLD);
+  coalesce_send(coal, election_sendbuf, st.right, TAG_ELECTION, MPI_COMM_WORLD);
+  st.lnum_sent+= 2;
 
   // Current leader is max_so_far
-  while (k < last+1) {
+  while (st.k < st.last+1) {
 
-    MPI_Recv(recvbuf, SIZE_MSG, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-    lnum_recv++;
-    k = recvbuf[1], d = recvbuf[2];
+    if (coalesce_recv(coal, &ann, recvbuf, MPI_ANY_SOURCE, &status)) {
+      st.max_so_far = ann.msg[0];
+      break;
+    }
+    st.lnum_recv++;
+    hotspot_recv(&hot, status.MPI_TAG);
+    st.k = recvbuf[1], st.d = recvbuf[2];
+    timing_phase(&tm, st.k);
     if (status.MPI_TAG == TAG_IGNORE) {
-      if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
+      if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
       break;
     }
 
-    if (k > last) break;
+    if (st.k > st.last) break;
  
     // Deal with messages received from the left
-      if (status.MPI_SOURCE == left) {
+      if (status.MPI_SOURCE == st.left) {
     left_recv_tag = status.MPI_TAG;
 
       switch (left_recv_tag) {
         case TAG_ELECTION:    
-          if (recvbuf[0] > uid) {
-            if (recvbuf[2] <  (1 << k)) {
-              left_sendbuf[2] = d + 1, left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = k;
-              left_send_tag = TAG_ELECTION, left_send_dest = right;
-             } else if (d >= (1 << k)) {
+          if (recvbuf[0] > st.uid) {
+            if (recvbuf[2] <  (1 << st.k)) {
+              left_sendbuf[2] = st.d + 1, left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = st.k;
+              left_send_tag = TAG_ELECTION, left_send_dest = st.right;
+             } else if (st.d >= (1 << st.k)) {
               left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = recvbuf[1];
-              left_send_tag = TAG_REPLY, left_send_dest = left;
+              left_send_tag = TAG_REPLY, left_send_dest = st.left;
             } 
-          } else if (recvbuf[0] == uid) {
-            if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
-            left_sendbuf[0] = uid, left_sendbuf[1] = k+1, left_sendbuf[2] = 1;
-            left_send_tag = TAG_ELECTION, left_send_dest = right;
+          } else if (recvbuf[0] == st.uid) {
+            if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
+            if (mode != ANNOUNCE_RING && st.k >= st.last) { // back round the whole ring
+              announce_leader(&ann, st.uid);
+              endLoopFlag = 1;
+              break;
+            }
+            left_sendbuf[0] = st.uid, left_sendbuf[1] = st.k+1, left_sendbuf[2] = 1;
+            left_send_tag = TAG_ELECTION, left_send_dest = st.right;
           } else {
             break; 
           }
-          lnum_sent++;
-          MPI_Isend(left_sendbuf, SIZE_MSG, MPI_INT, left_send_dest, left_send_tag, MPI_COMM_WORLD, &request);
+          st.lnum_sent++;
+          coalesce_send(coal, left_sendbuf, left_send_dest, left_send_tag, MPI_COMM_WORLD);
           break;
 
       case TAG_REPLY:
-          if (recvbuf[0] != max_so_far) { // Improvement #1: compare to max_so_far instead of own uid
-            if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
+          if (recvbuf[0] != st.max_so_far) { // Improvement #1: compare to max_so_far instead of own uid
+            if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
             left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = recvbuf[1];
-            left_send_dest = right, left_send_tag = TAG_REPLY;
-            recvReplies[0][0] = recvbuf[0], recvReplies[0][1] = recvbuf[1];
+            left_send_dest = st.right, left_send_tag = TAG_REPLY;
+            st.replies[0][0] = recvbuf[0], st.replies[0][1] = recvbuf[1];
           } else {
-            if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
-            left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = k + 1, left_sendbuf[2] = 1;
-            lnum_sent+=2;
-           MPI_Isend(left_sendbuf, SIZE_MSG, MPI_INT, left, TAG_ELECTION, MPI_COMM_WORLD, &request); 
-           MPI_Isend(left_sendbuf, SIZE_MSG, MPI_INT, right, TAG_ELECTION, MPI_COMM_WORLD, &request);
+            if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
+            left_sendbuf[0] = recvbuf[0], left_sendbuf[1] = st.k + 1, left_sendbuf[2] = 1;
+            st.lnum_sent+=2;
+           coalesce_send(coal, left_sendbuf, st.left, TAG_ELECTION, MPI_COMM_WORLD); 
+           coalesce_send(coal, left_sendbuf, st.right, TAG_ELECTION, MPI_COMM_WORLD);
           }
           break;
 
@@ -184,48 +278,53 @@ int hs(int argc, char *argv[]) {
    
 
     // Deal with right received values
-      else if (status.MPI_SOURCE == right) {
+      else if (status.MPI_SOURCE == st.right) {
         right_recv_tag = status.MPI_TAG;
     switch (right_recv_tag) {
       case TAG_ELECTION:
-          if (recvbuf[0] > uid) { 
-            if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
-            if (d < (1 << k)) {
+          if (recvbuf[0] > st.uid) { 
+            if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
+            if (st.d < (1 << st.k)) {
               right_sendbuf[2] = recvbuf[2]+1, right_sendbuf[0] = recvbuf[0], right_sendbuf[1] = recvbuf[1];
-              right_send_tag = TAG_ELECTION, right_send_dest = left;
-            } else if (d >= (1 << k)) {
+              right_send_tag = TAG_ELECTION, right_send_dest = st.left;
+            } else if (st.d >= (1 << st.k)) {
               right_sendbuf[0] = recvbuf[0], right_sendbuf[1] = recvbuf[1];
-              right_send_tag = TAG_REPLY, right_send_dest = right;
+              right_send_tag = TAG_REPLY, right_send_dest = st.right;
             }
-          } else if (recvbuf[0] == uid) {
-            if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
-            right_sendbuf[0] = uid, right_sendbuf[1] = k+1, right_sendbuf[2] = 1;
-            right_send_tag = TAG_ELECTION, right_send_dest = left;
-            if (k >= last && recvbuf[0] == max_so_far) endLoopFlag = 1;
+          } else if (recvbuf[0] == st.uid) {
+            if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
+            if (mode != ANNOUNCE_RING && st.k >= st.last) {
+              announce_leader(&ann, st.uid);
+              endLoopFlag = 1;
+              break;
+            }
+            right_sendbuf[0] = st.uid, right_sendbuf[1] = st.k+1, right_sendbuf[2] = 1;
+            right_send_tag = TAG_ELECTION, right_send_dest = st.left;
+            if (st.k >= st.last && recvbuf[0] == st.max_so_far) endLoopFlag = 1;
           } else {
             break;           
           }
-          lnum_sent++;
-          MPI_Isend(right_sendbuf, SIZE_MSG, MPI_INT, right_send_dest, right_send_tag, MPI_COMM_WORLD, &request);
+          st.lnum_sent++;
+          coalesce_send(coal, right_sendbuf, right_send_dest, right_send_tag, MPI_COMM_WORLD);
           break;
 
     case TAG_REPLY:
-        if (recvbuf[0] != max_so_far) {
-          if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
+        if (recvbuf[0] != st.max_so_far) {
+          if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
           right_sendbuf[0] = recvbuf[0], right_sendbuf[1] = recvbuf[1];
-          right_send_tag = TAG_REPLY, right_send_dest = left;
-           recvReplies[1][0] = recvbuf[0], recvReplies[1][1] = recvbuf[1];
+          right_send_tag = TAG_REPLY, right_send_dest = st.left;
+           st.replies[1][0] = recvbuf[0], st.replies[1][1] = recvbuf[1];
 
         } else {
-          if (recvbuf[0] > max_so_far) max_so_far = recvbuf[0];
-            if (recvReplies[1][0] == recvbuf[0] && recvReplies[1][1] == recvbuf[1]) {
-          left_sendbuf[0] = uid,  
-           left_sendbuf[1] = k+1, right_sendbuf[2] = left_sendbuf[2] = 1;
-          lnum_sent+=2;
-          MPI_Isend(left_sendbuf, SIZE_MSG, MPI_INT, left, TAG_ELECTION, MPI_COMM_WORLD, &request);
-          MPI_Isend(left_sendbuf, SIZE_MSG, MPI_INT, right, TAG_ELECTION, MPI_COMM_WORLD, &request);
+          if (recvbuf[0] > st.max_so_far) st.max_so_far = recvbuf[0];
+            if (st.replies[1][0] == recvbuf[0] && st.replies[1][1] == recvbuf[1]) {
+          left_sendbuf[0] = st.uid,  
+           left_sendbuf[1] = st.k+1, right_sendbuf[2] = left_sendbuf[2] = 1;
+          st.lnum_sent+=2;
+          coalesce_send(coal, left_sendbuf, st.left, TAG_ELECTION, MPI_COMM_WORLD);
+          coalesce_send(coal, left_sendbuf, st.right, TAG_ELECTION, MPI_COMM_WORLD);
            } else {
-            recvReplies[1][0] = recvbuf[0], recvReplies[1][1] = recvbuf[1];
+            st.replies[1][0] = recvbuf[0], st.replies[1][1] = recvbuf[1];
           }
         break;
       }
@@ -240,35 +339,57 @@ int hs(int argc, char *argv[]) {
     }
  }
   
-  int msgBuf[3] = {max_so_far, 0, 0}, msgRecv[3];
+  // Everything goes out before the totals lap, while both neighbours are still here
+  coalesce_flush(coal);
+
+  // The probes are long gone, so their buffer carries the totals
+  int *msgBuf = election_sendbuf, *msgRecv = recvbuf;
+  msgBuf[0] = st.max_so_far, msgBuf[1] = msgBuf[2] = 0;
 
   // Election is over - tell the other processes
-  MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, left, TAG_IGNORE, MPI_COMM_WORLD, &request);
-  MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_IGNORE, MPI_COMM_WORLD, &request);
-  MPI_Request_free(&request);
-
-  if (verbose) printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, (max_so_far == uid), lnum_recv, lnum_sent);
-  if (max_so_far == uid) {
-      msgBuf[0] = lnum_recv, msgBuf[1] = lnum_sent, msgBuf[2] = uid;
-      max_so_far = uid;
-      MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request); 
+  if (mode == ANNOUNCE_RING) {
+    MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, st.left, TAG_IGNORE, MPI_COMM_WORLD, &request);
+    MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, st.right, TAG_IGNORE, MPI_COMM_WORLD, &request);
+    MPI_Request_free(&request);
+  }
+
+  if (st.max_so_far == st.uid) timing_leader(&tm);
+  announce_end(&ann);
+  st.lnum_sent += ann.sent, st.lnum_recv += ann.rcvd;
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = st.uid, .leader = (st.max_so_far == st.uid), .initiator = 1, .participant = 1,
+                         .mrcvd = st.lnum_recv, .msent = st.lnum_sent, .phase = st.k, .elapsed = MPI_Wtime() - t_start };
+  if (st.max_so_far == st.uid) {
+      msgBuf[0] = st.lnum_recv, msgBuf[1] = st.lnum_sent, msgBuf[2] = st.uid;
+      st.max_so_far = st.uid;
+      MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, st.right, TAG_MSGNUM, lap, &request); 
   } else {
      // Non-leaders, do a receive and a send for their message totals as well
-      MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status);
+      MPI_Recv(msgRecv, SIZE_MSG, MPI_INT, st.left, TAG_MSGNUM, lap, &status);
       // increase its count by 1 for each receive and send
-      msgBuf[0] = msgRecv[0]+ lnum_recv, msgBuf[1] = msgRecv[1]+ lnum_sent;
-      max_so_far = msgBuf[2];
-      MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD, &request); 
+      msgBuf[0] = msgRecv[0]+ st.lnum_recv, msgBuf[1] = msgRecv[1]+ st.lnum_sent, msgBuf[2] = msgRecv[2];
+      st.max_so_far = msgBuf[2]; // the leader's uid, so a uid of 0 doesn't wait for the totals as well
+      MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, st.right, TAG_MSGNUM, lap, &request); 
   }
 
   // Leader receives/prints total number of messages received and sent
-  if (max_so_far == uid) {
-    MPI_Recv(msgRecv, 3, MPI_INT, left, TAG_MSGNUM, MPI_COMM_WORLD, &status); 
+  if (st.max_so_far == st.uid) {
+    MPI_Recv(msgRecv, 3, MPI_INT, st.left, TAG_MSGNUM, lap, &status); 
     tnum_recv = msgRecv[0];
     tnum_sent = msgRecv[1];
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, st.uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
   }
 
+  if (lap != MPI_COMM_WORLD) MPI_Comm_free(&lap);
+  timing_report(&tm, st.max_so_far == st.uid, "phase");
+  load_report(&opts.uids, st.uid, st.max_so_far == st.uid ? st.uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) mem_report(mem_stack_mark(0, MEM_STACK_PAINT, &opts), sizeof(st), MPI_COMM_WORLD);
+  if (recv_shown) recv_report(&rs, stats.elapsed, MPI_COMM_WORLD);
+  if (opts.placement) hotspot_report(&hot, st.lnum_sent, st.lnum_recv, stats.elapsed, rs.waited, tag_names, MPI_COMM_WORLD);
+  if (coal) coalesce_report(coal, stats.elapsed, MPI_COMM_WORLD);
+  coalesce_free(coal);
+
   MPI_Finalize();
   return 0;
 }
@@ -0,0 +1,174 @@
+/**
+ * lcr-block.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./lcr-block [ -k <kernel> ] [ -u <uid distribution> ] [ -s <seed> ] <Ring size> <Process number>
+ *
+ * Synchronous LCR on a ring of <Ring size> processes, much larger than the
+ * MPI job: each MPI process owns a contiguous segment of the ring and runs
+ * it with the vectorized round kernel in common/lcrvec.c (kernel scalar,
+ * avx2, avx512 or auto, the default). Only the message leaving the last
+ * process of a segment goes over MPI, once per round, to the next MPI
+ * process. Leader and message counts are the ones lcr.c gives on the same
+ * ring with the same uids (-u, -s and <Process number> as for lcr).
+ *
+ * Each boundary message carries a done flag, set once every process in the
+ * sender's segment has left the election; nothing more can come from it, so
+ * the receiver stops listening. An MPI process stops when its own segment is
+ * done and its left neighbour's is too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "load.h"
+#include "lcrvec.h"
+
+// Tags
+#define TAG_BOUNDARY 2
+
+#define SIZE_MSG 3
+
+int gcd(int size, int pnum);
+
+/** FG-MPI Boilerplate begins **/
+int lcr_block(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&lcr_block);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+int lcr_block(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  lcrvec_isa_t isa = LCRVEC_AUTO;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  if (argc == 5 && !strcmp(argv[1], "-k")) {
+    if (lcrvec_isa_parse(argv[2], &isa)) argc = -1;
+    argv += 2, argc -= 2;
+  }
+  if (argc != 3 || argv[1][0] == '-' || argv[2][0] == '-' || opts.stats_path || opts.timing) {
+    printf("Usage: ./lcr-block [ -k <kernel> ] [ -u <uid distribution> ] [ -s <seed> ] <Ring size> <Process number>\n");
+    exit(1);
+  }
+  int ring = atoi(argv[1]), pnum = atoi(argv[2]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  MPI_Request request = MPI_REQUEST_NULL;
+  MPI_Status status;
+
+  if (ring < size || ring < 3) {
+    printf("Usage: ring size %d must be at least 3 and at least the number of processes.\n", ring);
+    exit(1);
+  }
+  if (pnum <= ring || (int) pnum/ring < 7 || gcd(ring, pnum) != 1) {
+    printf("Usage: pnum is %d must be at least 7 times larger than and relatively coprime to the ring size.\n", pnum);
+    exit(1);
+  }
+
+  // This process's segment of the ring
+  int first = (int) ((long long) ring * rank / size);
+  int len = (int) ((long long) ring * (rank + 1) / size) - first;
+  int left = (rank + size - 1) % size, right = (rank + 1) % size;
+  int i;
+
+  int *uids = malloc(len * sizeof(int));
+  if (!uids) {
+    printf("Process %d: out of memory for %d uids\n", rank, len);
+    exit(1);
+  }
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_STRIDE;
+  for (i = 0; i < len; i++) {
+    opts_srand(&opts, first + i);
+    uids[i] = uid_generate(&opts.uids, first + i, ring, pnum);
+  }
+
+  lcrvec_t v;
+  int sendbuf[SIZE_MSG], recvbuf[SIZE_MSG];
+  int left_done = 0, told_right = 0;
+  long long round = 0, last_round = 0;
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double t_start = MPI_Wtime();
+
+  if (lcrvec_init(&v, len, uids, isa, &sendbuf[0], &sendbuf[1])) {
+    printf("Process %d: out of memory for a segment of %d\n", rank, len);
+    exit(1);
+  }
+  sendbuf[2] = 0;
+  MPI_Isend(sendbuf, SIZE_MSG, MPI_INT, right, TAG_BOUNDARY, MPI_COMM_WORLD, &request);
+
+  while (!left_done || !told_right) {
+    int in_val = 0, in_tag = 0;
+    unsigned long long rcvd = v.rcvd;
+
+    if (!left_done) {
+      MPI_Recv(recvbuf, SIZE_MSG, MPI_INT, left, TAG_BOUNDARY, MPI_COMM_WORLD, &status);
+      in_val = recvbuf[0], in_tag = recvbuf[1], left_done = recvbuf[2];
+    }
+
+    round++;
+    MPI_Wait(&request, &status);
+    lcrvec_round(&v, in_val, in_tag, &sendbuf[0], &sendbuf[1]);
+    if (v.rcvd != rcvd) last_round = round;
+
+    if (!told_right) {
+      sendbuf[2] = told_right = (v.done == len);
+      MPI_Isend(sendbuf, SIZE_MSG, MPI_INT, right, TAG_BOUNDARY, MPI_COMM_WORLD, &request);
+    }
+  }
+  MPI_Wait(&request, &status);
+  double elapsed = MPI_Wtime() - t_start;
+
+  // Totals, the leader's ring position and uid (-1 from everyone else), rounds and time
+  long long local[5] = { (long long) v.rcvd, (long long) v.sent, v.leader < 0 ? -1 : first + v.leader,
+                         v.leader < 0 ? -1 : uids[v.leader], last_round }, total[5];
+  double t_max;
+  MPI_Reduce(local, total, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce(local + 2, total + 2, 3, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&elapsed, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  if (!rank) {
+    printf("Leader: rank=%lld, id=%lld, trcvd=%lld, tsent=%lld, uids=%s\n", total[2], total[3], total[0], total[1],
+           uid_name(&opts.uids));
+    printf("Block: ring=%d, segments=%d, kernel=%s, rounds=%lld, seconds=%.3f\n", ring, size,
+           lcrvec_isa_name(v.isa), total[4], t_max);
+  }
+
+  int max_uid = uids[0];
+  for (i = 1; i < len; i++) if (uids[i] > max_uid) max_uid = uids[i];
+  load_report(&opts.uids, max_uid, rank ? -1 : (int) total[3], ring, MPI_COMM_WORLD);
+
+  lcrvec_free(&v);
+  free(uids);
+  MPI_Finalize();
+  return 0;
+}
+
+int gcd(int size, int pnum) {
+  int k = size, m = pnum;
+  while (k != m) {
+    if (k > m) k = k-m;
+    else m = m-k;
+   }
+   return k;
+}
@@ -11,13 +11,25 @@
  *
  * uids are not randomly assigned, so that we can have a single initiator.
  *
+ * Pass-through nodes are picked from rank and seed (common/passthru.h), so
+ * binding_func binds them to lcr_forward, which keeps no election state and
+ * only relays, unless -v, -o or -t need every rank in the election's
+ * collectives. -m prints the stack and resident memory of both kinds.
+ *
  */
 
 #include "mpi.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "passthru.h"
+#include "mem.h"
 
 // Tags
 #define TAG_PHASE1 2
@@ -36,7 +48,12 @@ int gcd(int size, int pnum);
 
 /** FG-MPI Boilerplate begins **/
 int lcr_passthru(int argc, char* argv[]);
+int lcr_forward(int argc, char* argv[]);
 FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  if (opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY) == 2 && !opts.stats_path && !opts.timing && passthru_rank(rank, opts.uids.seed))
+    return (&lcr_forward);
   return (&lcr_passthru);
 }
 
@@ -58,12 +75,16 @@ int main(int argc, char *argv[]) {
  */
 int lcr_passthru(int argc, char *argv[]) {
 
-  if (argc != 2 && argc != 3) {
-    printf("Usage: ./lcr-passthru [ -v ] <Process number>\n");
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+  if ((argc != 2 && argc != 3) || (argc == 3 && strcmp(argv[1], "-v") && strcmp(argv[2], "-v"))) {
+    printf("Usage: ./lcr-passthru [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE " <Process number>\n");
     exit(1);
   }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
 
-  int rank, size, uid, pnum;
+  int rank, size, uid, pnum = 0, initialized;
   int tag, max_so_far;
   int recv_buf[2];
 
@@ -78,9 +99,12 @@ int lcr_passthru(int argc, char *argv[]) {
     else if (!strcmp(argv[2], "-v")) pnum = atoi(argv[1]),  verbose = 1;
   } else if (argc == 2) 
     pnum = atoi(argv[1]);
+  if (opts.stats_path) verbose = 1;
  
 
-  MPI_Init(&argc, &argv);
+  MPI_Initialized(&initialized);
+  if (!initialized) MPI_Init(&argc, &argv);  // lcr_forward hands the initiator over initialized
+  double t_start = MPI_Wtime();
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
   MPI_Request request;
@@ -96,18 +120,22 @@ int lcr_passthru(int argc, char *argv[]) {
   int send_neighbour = (rank+1) % size, recv_neighbour = rank - 1;
   if (!rank) recv_neighbour = size - 1;
 
-  srand(time(NULL) + rank);
-  //uid = (rand() % pnum);
-  uid = ((rank+1)*pnum) % size;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_ARITH;
+  uid = uid_generate(&opts.uids, rank, size, pnum);
   int initiator = (uid % size) == (size - 1)/2; 
   int participant = 0;
-  int rnd = rand() % size;
-  int canParticipate = (rnd % 5);
+  int canParticipate = !passthru_rank(rank, opts.uids.seed);
 
 
   max_so_far = uid;
   tag = TAG_PHASE1;
 
+  timing_t tm;
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
   if (initiator) {
     printf("Process %d is an initiator\n", rank);
     participant = 1;
@@ -120,6 +148,7 @@ int lcr_passthru(int argc, char *argv[]) {
   while (my_state == ACTIVE && canParticipate) { 
       MPI_Recv(&recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
       lnum_recv++;
+      if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
  
       // Got an election message or a smaller uid than the least seen so far, so I know I lost
       if (status.MPI_TAG == TAG_ELECTION || recv_buf[0] > max_so_far) {
@@ -135,6 +164,8 @@ int lcr_passthru(int argc, char *argv[]) {
       if (recv_buf[0] == uid) {
         max_so_far = uid;
         my_state = LEADER;
+        timing_leader(&tm);
+        timing_phase(&tm, 1);
         tag = TAG_ELECTION;
         MPI_Isend(&uid, SIZE_MSG, MPI_INT, send_neighbour, tag, MPI_COMM_WORLD, &request);
         lnum_sent++;
@@ -149,6 +180,7 @@ int lcr_passthru(int argc, char *argv[]) {
   while (1) {
     MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
     lnum_recv++;
+    if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
     if ((my_state == NONACTIVE || !canParticipate) && status.MPI_TAG == TAG_ELECTION) {
       if (recv_buf[0] >  max_so_far) max_so_far = recv_buf[0];
       MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
@@ -163,8 +195,10 @@ int lcr_passthru(int argc, char *argv[]) {
     lnum_sent++;
   }
 
-  if (canParticipate && participant && verbose) 
-  printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, max_so_far == uid, lnum_recv, lnum_sent);
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = uid, .leader = (max_so_far == uid), .initiator = initiator,
+                         .participant = canParticipate && participant, .mrcvd = lnum_recv, .msent = lnum_sent,
+                         .elapsed = MPI_Wtime() - t_start };
 
   // Non-leaders, send your local message totals
   int msgBuf[2] = { lnum_recv, lnum_sent };
@@ -182,15 +216,70 @@ int lcr_passthru(int argc, char *argv[]) {
       MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, TAG_MSGNUM, MPI_COMM_WORLD, &status);      
       tnum_recv = recv_buf[0]; tnum_sent = recv_buf[1];
 
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
   }
 
+  timing_report(&tm, my_state == LEADER && participant, "lap");
+  load_report(&opts.uids, uid, my_state == LEADER && participant ? uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) passthru_mem_report(0, mem_stack_mark(0, MEM_STACK_PAINT, &opts), MPI_COMM_WORLD);
+
   
 
   MPI_Finalize();
   return 0;
 }
 
+/**
+ * A pass-through rank with nothing but the relay: everything from the left
+ * goes on to the right until the election message has passed, then the
+ * message totals do too, as in a pass-through lcr_passthru.
+ */
+int lcr_forward(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  int orig_argc = argc;
+  char **orig_argv = argv;
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // The initiator always takes part, even when it is picked to pass through
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_ARITH;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
+  if ((uid % size) == (size - 1)/2) return lcr_passthru(orig_argc, orig_argv);
+
+  int left = (rank + size - 1) % size, right = (rank + 1) % size;
+  int buf[2][SIZE_MSG], cur = 0;
+  MPI_Request request[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+  MPI_Status status;
+
+  // Two buffers, so one can be received into while the other is still going out
+  do {
+    MPI_Wait(&request[cur], MPI_STATUS_IGNORE);
+    MPI_Recv(buf[cur], SIZE_MSG, MPI_INT, left, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+    MPI_Isend(buf[cur], SIZE_MSG, MPI_INT, right, status.MPI_TAG, MPI_COMM_WORLD, &request[cur]);
+    cur ^= 1;
+  } while (status.MPI_TAG != TAG_ELECTION);
+
+  MPI_Wait(&request[cur], MPI_STATUS_IGNORE);
+  MPI_Recv(buf[cur], SIZE_MSG, MPI_INT, left, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+  MPI_Send(buf[cur], SIZE_MSG, MPI_INT, right, TAG_MSGNUM, MPI_COMM_WORLD);
+  MPI_Waitall(2, request, MPI_STATUSES_IGNORE);
+
+  load_report(&opts.uids, uid, -1, size, MPI_COMM_WORLD);
+  if (opts.memory) passthru_mem_report(1, mem_stack_mark(0, MEM_STACK_PAINT, &opts), MPI_COMM_WORLD);
+  MPI_Finalize();
+  return 0;
+}
+
 
 int gcd(int size, int pnum) {
   int k = size, m = pnum;  
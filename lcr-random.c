@@ -13,8 +13,14 @@
 #include "mpi.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "mem.h"
 
 // Tags
 #define TAG_PHASE1 2
@@ -56,12 +62,16 @@ int main(int argc, char *argv[]) {
  */
 int lcr_random(int argc, char *argv[]) {
 
-  if (argc != 2 && argc != 3) {
-    printf("Usage: ./lcr_random <Process number>\n");
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY), argv = args;
+  if ((argc != 2 && argc != 3) || (argc == 3 && strcmp(argv[1], "-v") && strcmp(argv[2], "-v"))) {
+    printf("Usage: ./lcr_random [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE " <Process number>\n");
     exit(1);
   }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
 
-  int rank, size, uid, pnum;
+  int rank, size, uid, pnum = 0;
   int tag, max_so_far;
   int recv_buf[2];
 
@@ -74,11 +84,13 @@ int lcr_random(int argc, char *argv[]) {
     else if (!strcmp(argv[2], "-v")) pnum = atoi(argv[1]),  verbose = 1;
   } else if (argc == 2) 
     pnum = atoi(argv[1]);
+  if (opts.stats_path) verbose = 1;
 
 
   process_state my_state = ACTIVE;
 
   MPI_Init(&argc, &argv);
+  double t_start = MPI_Wtime();
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
   MPI_Request request;
@@ -94,9 +106,9 @@ int lcr_random(int argc, char *argv[]) {
   int send_neighbour = (rank+1) % size, recv_neighbour = rank - 1;
   if (!rank) recv_neighbour = size - 1;
 
-  srand(time(NULL) + rank);
-  uid = (rand() % pnum);
-  //uid = ((rank+1)*pnum) % size;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  uid = uid_generate(&opts.uids, rank, size, pnum);
   int initiator = (((rand()+uid) % size) > (size - 1)/2);
   int participant = 0;
 
@@ -104,8 +116,12 @@ int lcr_random(int argc, char *argv[]) {
   max_so_far = uid;
   tag = TAG_PHASE1;
 
+  timing_t tm;
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
   if (initiator) {
-    if (verbose) printf("Process %d is an initiator\n", rank);
     participant = 1;
     MPI_Isend(&max_so_far, SIZE_MSG, MPI_INT, send_neighbour, tag, MPI_COMM_WORLD, &request);
     lnum_sent++;
@@ -115,6 +131,7 @@ int lcr_random(int argc, char *argv[]) {
   while (my_state == ACTIVE) { 
       MPI_Recv(&recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
       lnum_recv++;
+      if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
       // Got an election message or a smaller uid than the least seen so far, so I know I lost
       if (status.MPI_TAG == TAG_ELECTION || recv_buf[0] > max_so_far) {
         max_so_far = recv_buf[0];
@@ -129,6 +146,8 @@ int lcr_random(int argc, char *argv[]) {
       if (recv_buf[0] == uid) {
         max_so_far = uid;
         my_state = LEADER;
+        timing_leader(&tm);
+        timing_phase(&tm, 1);
         tag = TAG_ELECTION;
         MPI_Isend(&uid, SIZE_MSG, MPI_INT, send_neighbour, tag, MPI_COMM_WORLD, &request);
         lnum_sent++;
@@ -143,6 +162,7 @@ int lcr_random(int argc, char *argv[]) {
   while (1) {
     MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
     lnum_recv++;
+    if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
     if (my_state == NONACTIVE && status.MPI_TAG == TAG_ELECTION) {
       if (recv_buf[0] >  max_so_far) max_so_far = recv_buf[0];
       MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
@@ -157,8 +177,10 @@ int lcr_random(int argc, char *argv[]) {
     lnum_sent++;
   }
 
- if (participant && verbose) 
-  printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, max_so_far == uid, lnum_recv, lnum_sent);
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = uid, .leader = (max_so_far == uid), .initiator = initiator,
+                         .participant = participant, .mrcvd = lnum_recv, .msent = lnum_sent,
+                         .elapsed = MPI_Wtime() - t_start };
 
   // Non-leaders, send your local message totals
   int msgBuf[2] = { lnum_recv, lnum_sent };
@@ -176,9 +198,14 @@ int lcr_random(int argc, char *argv[]) {
       MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, TAG_MSGNUM, MPI_COMM_WORLD, &status);      
       tnum_recv = recv_buf[0]; tnum_sent = recv_buf[1];
 
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
   }
 
+  timing_report(&tm, my_state == LEADER && participant, "lap");
+  load_report(&opts.uids, uid, my_state == LEADER && participant ? uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) mem_report(mem_stack_mark(0, MEM_STACK_PAINT, &opts), 0, MPI_COMM_WORLD);
+
 
   MPI_Finalize();
   return 0;
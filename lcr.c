@@ -6,19 +6,38 @@
  * @author Mira Leung 
  *
  * Usage:
- * mpiexec -n <N PROCESSES> ./lcr <RELATIVELY COPRIME NUMBER TO N PROCESSES> [ 1 ] for randomly-assigned uids
+ * mpiexec -n <N PROCESSES> ./lcr [ -b ring|tree|ibcast ] [ -w block|poll[:<tests>]|spin ] [ -p ] [ -v ] [ -o <stats file> ] [ -u <uid distribution> ] [ -s <seed> ] <RELATIVELY COPRIME NUMBER TO N PROCESSES> [ 1 ] for randomly-assigned uids
  *
  * An implementation of Lelann/Chang-Roberts', except that it checks for the 
  * minimum uid seen so far, instead of against its own.
  * Unidirectional ring.
  *
+ * -b picks how the leader is announced (common/announce.h): the TAG_ELECTION
+ * lap by default, or in O(log n) hops with tree or ibcast, in which case the
+ * totals lap moves to a communicator of its own.
+ *
+ * -w picks how the election loops wait for a message (common/recv.h) and
+ * prints their CPU time, context switches and latency.
+ *
+ * -p prints how the messages and the waiting spread over OS processes and
+ * nodes, and the busiest of them (common/hotspot.h).
+ *
  */
 
 #include "mpi.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include <fgmpi.h>
+#include "options.h"
+#include "stats.h"
+#include "timing.h"
+#include "load.h"
+#include "announce.h"
+#include "mem.h"
+#include "recv.h"
+#include "hotspot.h"
 
 // Tags
 #define TAG_PHASE1 2
@@ -27,11 +46,26 @@
 #define TAG_NSENT 5
 #define TAG_MSGNUM 6
 
+// Election tags for -p
+static const char *const tag_names[HOTSPOT_TAGS] = { [TAG_PHASE1] = "phase1", [TAG_ELECTION] = "election" };
+
 #define SIZE_MSG 2
 
 // Process states
 typedef enum { NONINIT, INIT, LEADER } process_state; // A NONINIT process lost the election
 
+// Message buffers: own uid (then the totals) and the message being handled
+enum { BUF_PROBE, BUF_RECV, BUFS };
+
+// Everything an LCR process keeps during the election, in one place for -m
+typedef struct {
+  int uid, max_so_far;
+  int send_neighbour, recv_neighbour;
+  int lnum_sent, lnum_recv;
+  process_state my_state;
+  int buf[BUFS][SIZE_MSG];
+} lcr_state_t;
+
 int ceiling_log2(unsigned long long x);
 int gcd(int size, int pnum);
 
@@ -59,51 +93,56 @@ int main(int argc, char *argv[]) {
  */
 int lcr(int argc, char *argv[]) {
 
-  if (argc != 2 && argc != 3 && argc != 4) {
-    printf("Usage: ./lcr [ -v ] <Process number>\n");
-    exit(1);
-  }
-
-  int pnum;
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  announce_mode_t mode = ANNOUNCE_RING;
+  recv_t rs;
+  int recv_shown = 0;
+  recv_parse("block", &rs);
   int verbose = 0;
-  int rand_flag = 0;
-  if (argc == 4) {
+  argc = opts_parse_with(argc, argv, &opts, args, OPTS_MEMORY | OPTS_PLACEMENT), argv = args;
+  while (argc > 1 && argv[1][0] == '-') {
     if (!strcmp(argv[1], "-v")) {
-      pnum = atoi(argv[2]); 
-      rand_flag = atoi(argv[3]), verbose = 1;
-    } else if (!strcmp(argv[2], "-v")) {
-      pnum = atoi(argv[1]);
-      rand_flag = atoi(argv[3]),  verbose = 1;
-    } else if (!strcmp(argv[3], "-v")) {
-      pnum = atoi(argv[1]);
-      rand_flag = atoi(argv[2]), verbose = 1;
+      verbose = 1, argv++, argc--;
+      continue;
     }
-  } else if (argc == 3) {
-    if (!strcmp(argv[1], "-v")) {
-      pnum = atoi(argv[2]);
-      verbose = 1;
-    } else if (!strcmp(argv[2], "-v")) {
-      pnum = atoi(argv[1]);
-      verbose = 1;
+    if (argc < 3) break;
+    if (!strcmp(argv[1], "-b")) {
+      if (announce_parse(argv[2], &mode)) break;
+    } else if (!strcmp(argv[1], "-w")) {
+      if (recv_parse(argv[2], &rs)) break;
+      recv_shown = 1;
     } else {
-      pnum = atoi(argv[1]);
-      rand_flag = atoi(argv[2]);
+      break;
     }
-  } else if (argc == 2) 
-    pnum = atoi(argv[1]);
- 
+    argv += 2, argc -= 2;
+  }
+  // <Process number> [ 1 ], with -v also allowed after them
+  int pnum = 0, rand_flag = 0, npos = 0, k;
+  for (k = 1; k < argc && npos >= 0; k++) {
+    if (!strcmp(argv[k], "-v")) verbose = 1;
+    else if (argv[k][0] == '-' || npos == 2) npos = -1;
+    else if (npos++) rand_flag = atoi(argv[k]);
+    else pnum = atoi(argv[k]);
+  }
+  if (npos < 1) {
+    printf("Usage: ./lcr [ -b ring|tree|ibcast ] [ -w block|poll[:<tests>]|spin ] " OPTS_USAGE_PLACEMENT " [ -v ] " OPTS_USAGE_MEMORY " " OPTS_USAGE " <Process number>\n");
+    exit(1);
+  }
+  if (opts.memory) mem_stack_mark(1, MEM_STACK_PAINT, &opts);
 
+  if (opts.stats_path) verbose = 1;
+ 
 
-  int rank, size, uid;
-  int tag, max_so_far;
-  int recv_buf[2];
 
-  int lnum_sent = 0, lnum_recv = 0;
+  int rank, size;
+  int tag;
   int tnum_sent = 0, tnum_recv = 0;
-
-  process_state my_state = INIT;
+  lcr_state_t st = { .my_state = INIT };
+  int *probe = st.buf[BUF_PROBE], *recv_buf = st.buf[BUF_RECV];
 
   MPI_Init(&argc, &argv);
+  double t_start = MPI_Wtime();
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
   MPI_Request request;
@@ -114,82 +153,119 @@ int lcr(int argc, char *argv[]) {
     exit(1);
   }
 
-  int send_neighbour = (rank+1) % size, recv_neighbour = rank - 1;
-  if (!rank) recv_neighbour = size - 1;
+  st.send_neighbour = (rank + 1) % size, st.recv_neighbour = rank ? rank - 1 : size - 1;
 
-  srand(time(NULL)+rank);
-  uid = (rank+1)*(pnum % size);
-  if (rand_flag)  uid = (rand() % pnum);
-  max_so_far = uid;
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = rand_flag ? UID_RANDOM : UID_STRIDE;
+  st.uid = st.max_so_far = probe[0] = uid_generate(&opts.uids, rank, size, pnum);
   tag = TAG_PHASE1;
 
-  if (my_state == INIT) {
-    MPI_Isend(&max_so_far, SIZE_MSG, MPI_INT, send_neighbour, tag, MPI_COMM_WORLD, &request);
-    lnum_sent++;
+  MPI_Comm lap = MPI_COMM_WORLD;
+  if (mode != ANNOUNCE_RING) MPI_Comm_dup(MPI_COMM_WORLD, &lap);
+
+  timing_t tm;
+  announce_t ann;
+  hotspot_t hot = { { 0 } };
+  timing_init(&tm, opts.timing, MPI_COMM_WORLD);
+  announce_init(&ann, mode, &rs, MPI_COMM_WORLD);
+  rs.timed = opts.placement; // only -p reports the time spent waiting
+  recv_start(&rs);
+  timing_start(&tm);
+  timing_phase(&tm, 0);
+
+  if (st.my_state == INIT) {
+    MPI_Isend(probe, SIZE_MSG, MPI_INT, st.send_neighbour, tag, MPI_COMM_WORLD, &request);
+    st.lnum_sent++;
   }
 
   //  Everyone is an initiator by default
-  while (my_state == INIT) { 
-      MPI_Recv(&recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-      lnum_recv++;
+  while (st.my_state == INIT) { 
+      recv_msg(&rs, recv_buf, SIZE_MSG, MPI_INT, st.recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+      st.lnum_recv++;
+      hotspot_recv(&hot, status.MPI_TAG);
+      if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
    
       // Got an election message or a smaller uid than the least seen so far, so I know I lost
-      if (status.MPI_TAG == TAG_ELECTION || recv_buf[0] > max_so_far) {
-        max_so_far = recv_buf[0];
-        my_state = NONINIT; // lost the election
+      if (status.MPI_TAG == TAG_ELECTION || recv_buf[0] > st.max_so_far) {
+        st.max_so_far = recv_buf[0];
+        st.my_state = NONINIT; // lost the election
         // forward the message, and break;
-        MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
-        lnum_sent++;
+        MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, st.send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
+        st.lnum_sent++;
         break; 
       }
 
       // Got my own uid back; I'm the leader
-      if (recv_buf[0] == uid) {
-        max_so_far = uid;
-        my_state = LEADER;
+      if (recv_buf[0] == st.uid) {
+        st.max_so_far = st.uid;
+        st.my_state = LEADER;
+        timing_leader(&tm);
+        if (mode != ANNOUNCE_RING) {
+          announce_leader(&ann, st.uid);
+          break;
+        }
+        timing_phase(&tm, 1);
         tag = TAG_ELECTION;
-        MPI_Isend(&uid, SIZE_MSG, MPI_INT, send_neighbour, tag, MPI_COMM_WORLD, &request);
-        lnum_sent++;
+        MPI_Isend(probe, SIZE_MSG, MPI_INT, st.send_neighbour, tag, MPI_COMM_WORLD, &request);
+        st.lnum_sent++;
       } 
   }
 
   // Non-candidates forward messages
-  while (1) {
-    MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-    lnum_recv++;
-    if (my_state == NONINIT && status.MPI_TAG == TAG_ELECTION) {
-      if (recv_buf[0] >  max_so_far) max_so_far = recv_buf[0];
-      MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
-      lnum_sent++;
+  while (mode == ANNOUNCE_RING || st.my_state != LEADER) {
+    if (announce_recv(&ann, recv_buf, SIZE_MSG, st.recv_neighbour, &status)) {
+      st.max_so_far = ann.msg[0];
       break;
-    } else if  (my_state == LEADER && recv_buf[0] == uid && status.MPI_TAG == TAG_ELECTION) {
-      if (recv_buf[0] > max_so_far) max_so_far = recv_buf[0];
+    }
+    st.lnum_recv++;
+    hotspot_recv(&hot, status.MPI_TAG);
+    if (status.MPI_TAG == TAG_ELECTION) timing_phase(&tm, 1);
+    if (st.my_state == NONINIT && status.MPI_TAG == TAG_ELECTION) {
+      if (recv_buf[0] >  st.max_so_far) st.max_so_far = recv_buf[0];
+      MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, st.send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
+      st.lnum_sent++;
+      break;
+    } else if  (st.my_state == LEADER && recv_buf[0] == st.uid && status.MPI_TAG == TAG_ELECTION) {
+      if (recv_buf[0] > st.max_so_far) st.max_so_far = recv_buf[0];
       break;
     }
 
-    MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
-    lnum_sent++;
+    MPI_Isend(recv_buf, SIZE_MSG, MPI_INT, st.send_neighbour, status.MPI_TAG, MPI_COMM_WORLD, &request);
+    st.lnum_sent++;
   }
 
-  if (verbose) printf("rank=%d, id=%d, leader=%d, mrcvd=%d, msent=%d\n", rank, uid, max_so_far == uid, lnum_recv, lnum_sent);
+  announce_end(&ann);
+  st.lnum_sent += ann.sent, st.lnum_recv += ann.rcvd;
+  timing_end(&tm);
+  rank_stats_t stats = { .rank = rank, .uid = st.uid, .leader = (st.max_so_far == st.uid), .initiator = 1, .participant = 1,
+                         .mrcvd = st.lnum_recv, .msent = st.lnum_sent, .elapsed = MPI_Wtime() - t_start };
 
-  // Non-leaders, send your local message totals
-  int msgBuf[2] = { lnum_recv, lnum_sent };
-  if (my_state != LEADER) {
-    MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+  // Non-leaders, send your local message totals, from the buffer the uid went out in
+  int *msgBuf = probe;
+  msgBuf[0] = st.lnum_recv, msgBuf[1] = st.lnum_sent;
+  if (st.my_state != LEADER) {
+    MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, st.recv_neighbour, MPI_ANY_TAG, lap, &status);
 
     if (status.MPI_TAG == TAG_MSGNUM) msgBuf[0] += recv_buf[0], msgBuf[1] += recv_buf[1]; 
   }
-    MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, send_neighbour, TAG_MSGNUM, MPI_COMM_WORLD, &request);
+    MPI_Isend(msgBuf, SIZE_MSG, MPI_INT, st.send_neighbour, TAG_MSGNUM, lap, &request);
 
   // Leader receives/prints total number of messages sent and received
-  if (my_state == LEADER) {
-      MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, recv_neighbour, TAG_MSGNUM, MPI_COMM_WORLD, &status);      
+  if (st.my_state == LEADER) {
+      MPI_Recv(recv_buf, SIZE_MSG, MPI_INT, st.recv_neighbour, TAG_MSGNUM, lap, &status);      
       tnum_recv = recv_buf[0]; tnum_sent = recv_buf[1];
 
-    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d\n", rank, uid, tnum_recv, tnum_sent);  
+    printf("Leader: rank=%d, id=%d, trcvd=%d, tsent=%d, uids=%s\n", rank, st.uid, tnum_recv, tnum_sent, uid_name(&opts.uids));  
   }
 
+  if (lap != MPI_COMM_WORLD) MPI_Comm_free(&lap);
+  timing_report(&tm, st.my_state == LEADER, "lap");
+  load_report(&opts.uids, st.uid, st.my_state == LEADER ? st.uid : -1, size, MPI_COMM_WORLD);
+  if (verbose) stats_write(opts.stats_path ? opts.stats_path : STATS_DEFAULT_PATH, &stats, MPI_COMM_WORLD);
+  if (opts.memory) mem_report(mem_stack_mark(0, MEM_STACK_PAINT, &opts), sizeof(st), MPI_COMM_WORLD);
+  if (recv_shown) recv_report(&rs, stats.elapsed, MPI_COMM_WORLD);
+  if (opts.placement) hotspot_report(&hot, st.lnum_sent, st.lnum_recv, stats.elapsed, rs.waited, tag_names, MPI_COMM_WORLD);
+
   MPI_Finalize();
   return 0;
 }
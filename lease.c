@@ -0,0 +1,289 @@
+/**
+ * lease.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./lease [ -a hs|lcr|chord ] [ -b ring|tree ] [ -i <interval ms> ] [ -l <lease ms> ] [ -d <seconds> ] [ -F <failovers> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ *
+ * A leader lease on top of an election. The processes elect a leader with
+ * libelect, and the leader sends a heartbeat every <interval> ms (default 10),
+ * either round the ring (-b ring: each follower passes it to its right
+ * neighbour, the leader's left neighbour ends it) or down a binomial tree
+ * rooted at the leader (-b tree). A follower renews its lease, <lease> ms (default 5 intervals), on
+ * every heartbeat, and when the lease runs out it treats the leader as failed
+ * and starts a new election among the survivors.
+ *
+ * The failures are staged: after <seconds> of heartbeats (default 1) the
+ * leader stops, as if it had crashed, and drops out of the membership
+ * (MPI_Comm_split with MPI_UNDEFINED, so the survivors' split can complete).
+ * A follower whose lease has run out joins an MPI_Ibarrier, which the leader
+ * joins when it stops, and keeps passing heartbeats on until it completes;
+ * only then does it split. So a lease that runs out early doesn't cut the
+ * heartbeats off from the rest of the ring or tree.
+ * This repeats <failovers> times (default 1). Times come from clocks synced
+ * as for -t (common/timing.c). For each failover rank 0 prints, from the
+ * moment the leader stopped:
+ *   detect_first / detect_last   the first and last follower's lease expiring
+ *   new_leader                   every survivor knowing the new leader
+ *   false_alarms                 leases that ran out while the leader was alive
+ * and the heartbeat overhead while the leader was up, in messages and bytes
+ * per second over the whole job.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+#include "timing.h"
+#include "elect.h"
+
+// Tags
+#define TAG_BEAT 2
+
+#define SIZE_MSG 2
+#define MAX_FAILOVERS 16
+#define MAX_CHILDREN 32 // in the binomial tree; one on the ring
+
+// Per-failover values reduced at the end
+enum { F_FAIL, F_DETECT_FIRST, F_DETECT_LAST, F_ELECTED, F_LEADER, F_UID, F_BEATS, F_ALARMS, F_COUNT };
+
+typedef enum { RING, TREE } beat_mode_t;
+
+// A process's copy of the last heartbeat it sent on, kept until those sends complete
+typedef struct {
+  int beat[SIZE_MSG];
+  MPI_Request reqs[MAX_CHILDREN];
+  int nreqs;
+} relay_t;
+
+/** FG-MPI Boilerplate begins **/
+int lease(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&lease);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+/**
+ * Sends a heartbeat on from this process: to the right neighbour on the ring,
+ * unless that is the leader, or to its children in the binomial tree rooted at
+ * the leader. The previous heartbeat's sends are completed first, so beat is
+ * copied into r only once nothing reads r any more; the receivers are still
+ * taking heartbeats then, as nobody stops before the barrier at the failure.
+ * Returns the number of messages sent.
+ */
+static int pass_beat(relay_t *r, const int *beat, beat_mode_t mode, int rank, int size, int leader, MPI_Comm comm) {
+  int rel = (rank - leader + size) % size, mask;
+
+  MPI_Waitall(r->nreqs, r->reqs, MPI_STATUSES_IGNORE);
+  memcpy(r->beat, beat, sizeof(r->beat));
+  r->nreqs = 0;
+  if (mode == RING) {
+    if ((rank + 1) % size == leader) return 0;
+    MPI_Isend(r->beat, SIZE_MSG, MPI_INT, (rank + 1) % size, TAG_BEAT, comm, &r->reqs[r->nreqs++]);
+    return 1;
+  }
+  // Children are rel + mask for every mask below rel's lowest set bit
+  for (mask = 1; mask < size && !(rel & mask); mask <<= 1) {
+    if (rel + mask >= size) continue;
+    MPI_Isend(r->beat, SIZE_MSG, MPI_INT, (leader + rel + mask) % size, TAG_BEAT, comm, &r->reqs[r->nreqs++]);
+  }
+  return r->nreqs;
+}
+
+/**
+ * Lets go of the last heartbeat's sends at the end of a failover. A receiver
+ * that got past the barrier no longer takes them, so they may never complete;
+ * r is not reused, and it lives until MPI_Finalize.
+ */
+static void relay_release(relay_t *r) {
+  int k;
+  for (k = 0; k < r->nreqs; k++) MPI_Request_free(&r->reqs[k]);
+  r->nreqs = 0;
+}
+
+int lease(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  elect_algo_t algo = ELECT_HS;
+  beat_mode_t mode = RING;
+  double interval = 10, lease_ms = -1, up = 1;
+  int failovers = 1;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-a")) {
+      if (elect_algo_parse(argv[2], &algo)) break;
+    } else if (!strcmp(argv[1], "-b")) {
+      if (!strcmp(argv[2], "ring")) mode = RING;
+      else if (!strcmp(argv[2], "tree")) mode = TREE;
+      else break;
+    } else if (!strcmp(argv[1], "-i")) {
+      interval = atof(argv[2]);
+    } else if (!strcmp(argv[1], "-l")) {
+      lease_ms = atof(argv[2]);
+    } else if (!strcmp(argv[1], "-d")) {
+      up = atof(argv[2]);
+    } else if (!strcmp(argv[1], "-F")) {
+      failovers = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (lease_ms < 0) lease_ms = 5 * interval;
+  if (argc != 2 || interval <= 0 || lease_ms <= 0 || up <= 0 || failovers < 1 || failovers > MAX_FAILOVERS ||
+      opts.stats_path || opts.timing) {
+    printf("Usage: ./lease [ -a hs|lcr|chord ] [ -b ring|tree ] [ -i <interval ms> ] [ -l <lease ms> ] [ -d <seconds> ] [ -F <failovers> ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (failovers > size - 2) {
+    printf("Usage: %d failovers need at least %d processes\n", failovers, failovers + 2);
+    exit(1);
+  }
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  elect_options_t eopts = { uid_generate(&opts.uids, rank, size, pnum), 0 };
+  elect_result_t res, first;
+
+  timing_t tm;
+  timing_init(&tm, 1, MPI_COMM_WORLD);
+
+  // Everything this process saw, with neutral values where it has nothing to add
+  double f[MAX_FAILOVERS][F_COUNT], detect[MAX_FAILOVERS];
+  relay_t relay[MAX_FAILOVERS];
+  int i, j, alive = 1;
+  for (i = 0; i < MAX_FAILOVERS; i++) {
+    f[i][F_FAIL] = -1e300, f[i][F_DETECT_FIRST] = 1e300, f[i][F_DETECT_LAST] = -1e300, f[i][F_ELECTED] = -1e300;
+    f[i][F_LEADER] = f[i][F_UID] = -1, f[i][F_BEATS] = f[i][F_ALARMS] = 0;
+    detect[i] = 0;
+  }
+  memset(relay, 0, sizeof(relay));
+
+  MPI_Comm comm, next;
+  MPI_Request barrier;
+  int crank, csize;
+  MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+  elect_leader(comm, algo, &eopts, &res);
+  first = res;
+
+  for (i = 0; i < failovers; i++) {
+    MPI_Comm_rank(comm, &crank);
+    MPI_Comm_size(comm, &csize);
+    int beat[SIZE_MSG] = { 0, res.leader_uid }, msgs = 0;
+    double now = timing_now(&tm), t_up = now;
+
+    if (res.is_leader) {
+      // Beat for the given time, then fail
+      double next_beat = now, end = now + up;
+      while ((now = timing_now(&tm)) < end) {
+        if (now >= next_beat) {
+          beat[0]++;
+          msgs += pass_beat(&relay[i], beat, mode, crank, csize, crank, comm);
+          next_beat += interval / 1000;
+        }
+        MPIX_Yield();
+      }
+      f[i][F_FAIL] = now;
+      f[i][F_BEATS] = msgs / (now - t_up);
+      alive = 0;
+      MPI_Ibarrier(comm, &barrier);
+      MPI_Wait(&barrier, MPI_STATUS_IGNORE);
+      relay_release(&relay[i]);
+      MPI_Comm_split(comm, MPI_UNDEFINED, rank, &next);
+      MPI_Comm_free(&comm);
+      break;
+    }
+
+    // Follow until the lease runs out, and pass heartbeats on until everyone has stopped
+    double expiry = now + lease_ms / 1000;
+    int flag, expired = 0;
+    MPI_Status status;
+    while (1) {
+      MPI_Iprobe(MPI_ANY_SOURCE, TAG_BEAT, comm, &flag, &status);
+      now = timing_now(&tm);
+      if (flag) {
+        MPI_Recv(beat, SIZE_MSG, MPI_INT, status.MPI_SOURCE, TAG_BEAT, comm, MPI_STATUS_IGNORE);
+        expiry = now + lease_ms / 1000;
+        msgs += pass_beat(&relay[i], beat, mode, crank, csize, res.leader_rank, comm);
+        continue;
+      }
+      if (!expired && now > expiry) {
+        expired = 1;
+        detect[i] = now;
+        f[i][F_DETECT_FIRST] = f[i][F_DETECT_LAST] = now;
+        MPI_Ibarrier(comm, &barrier);
+      }
+      if (expired) {
+        MPI_Test(&barrier, &flag, MPI_STATUS_IGNORE);
+        if (flag) break;
+      }
+      MPIX_Yield();
+    }
+    f[i][F_BEATS] = msgs / (now - t_up);
+    relay_release(&relay[i]);
+
+    // Survivors elect again; heartbeats still in flight die with the old communicator
+    MPI_Comm_split(comm, 0, rank, &next);
+    MPI_Comm_free(&comm);
+    comm = next;
+    elect_leader(comm, algo, &eopts, &res);
+    f[i][F_ELECTED] = timing_now(&tm);
+    if (res.is_leader) f[i][F_LEADER] = rank, f[i][F_UID] = res.leader_uid;
+  }
+  if (alive) MPI_Comm_free(&comm);
+
+  // False alarms need every failure time
+  double fail[MAX_FAILOVERS], t_fail[MAX_FAILOVERS];
+  for (i = 0; i < MAX_FAILOVERS; i++) fail[i] = f[i][F_FAIL];
+  MPI_Allreduce(fail, t_fail, MAX_FAILOVERS, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  for (i = 0; i < failovers; i++) f[i][F_ALARMS] = detect[i] && detect[i] < t_fail[i];
+
+  // Minima are negated on the way in and out, so one MPI_MAX and one MPI_SUM do
+  double mx[MAX_FAILOVERS][F_COUNT], tmx[MAX_FAILOVERS][F_COUNT], sm[MAX_FAILOVERS][2], tsm[MAX_FAILOVERS][2];
+  for (i = 0; i < MAX_FAILOVERS; i++) {
+    for (j = 0; j < F_COUNT; j++) mx[i][j] = f[i][j];
+    mx[i][F_DETECT_FIRST] = -f[i][F_DETECT_FIRST];
+    sm[i][0] = f[i][F_BEATS], sm[i][1] = f[i][F_ALARMS];
+  }
+  MPI_Reduce(mx, tmx, MAX_FAILOVERS * F_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce(sm, tsm, MAX_FAILOVERS * 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (!rank) {
+    printf("Leader: rank=%d, id=%d, trcvd=%llu, tsent=%llu, uids=%s\n", first.leader_rank, first.leader_uid,
+           first.msgs_rcvd, first.msgs_sent, uid_name(&opts.uids));
+    for (i = 0; i < failovers; i++) {
+      double t0 = tmx[i][F_FAIL];
+      printf("Failover %d: new_leader=%d, id=%d, detect_first=%.6f, detect_last=%.6f, new_leader_after=%.6f, "
+             "false_alarms=%.0f, beat_msgs_per_sec=%.1f, beat_bytes_per_sec=%.1f\n", i + 1, (int) tmx[i][F_LEADER],
+             (int) tmx[i][F_UID], -tmx[i][F_DETECT_FIRST] - t0, tmx[i][F_DETECT_LAST] - t0, tmx[i][F_ELECTED] - t0,
+             tsm[i][1], tsm[i][0], tsm[i][0] * SIZE_MSG * sizeof(int));
+    }
+    printf("Lease: algorithm=%s, mode=%s, interval_ms=%.3f, lease_ms=%.3f, up=%.3f, failovers=%d, max_skew=%.6f\n",
+           elect_algo_name(algo), mode == RING ? "ring" : "tree", interval, lease_ms, up, failovers, tm.skew);
+  }
+
+  // timing_report() would free the clock's communicator; nothing is reported through it here
+  MPI_Comm_free(&tm.comm);
+  MPI_Finalize();
+  return 0;
+}
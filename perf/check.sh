@@ -0,0 +1,155 @@
+#!/bin/sh
+#
+# check.sh
+#
+# Usage:
+# sh perf/check.sh [ -g | -b ]     (make perf-check, make perf-golden, make perf-baseline)
+#
+# Runs every point in perf/golden PERF_REPS times (default 3) and fails if
+#   - a run fails, times out (PERF_TIMEOUT seconds, default 60) or doesn't
+#     print exactly one Leader line
+#   - tsent differs from the golden count (unless that is *)
+#   - tsent is above the analytic bound of the point's algorithm
+#   - the best wall time of the point is more than PERF_TOLERANCE percent
+#     (default 25) plus PERF_SLACK seconds (default 0.1, for launch noise)
+#     over its time in perf/baseline
+# perf/baseline holds this machine's times, so it isn't checked in; a point
+# with no time there has it recorded. -g rewrites the counts in perf/golden
+# from this run, -b rewrites perf/baseline. Runs are launched as
+#   $MPIEXEC -nfg <nfg> -n <n> ./<program> <arguments>
+# with MPIEXEC defaulting to mpiexec, or for shim/<program> (make shim) as
+#   ./shim/<program> -np <nfg * n> <arguments>
+
+cd "$(dirname "$0")/.." || exit 1
+
+GOLDEN=perf/golden
+BASELINE=perf/baseline
+MPIEXEC=${MPIEXEC:-mpiexec}
+REPS=${PERF_REPS:-3}
+TOLERANCE=${PERF_TOLERANCE:-25}
+SLACK=${PERF_SLACK:-0.1}
+TIMEOUT=${PERF_TIMEOUT:-60}
+OUT=${TMPDIR:-/tmp}/perf-check.$$
+
+case "$1" in
+  "") mode=check ;;
+  -g) mode=golden ;;
+  -b) mode=baseline ;;
+  *) echo "Usage: sh perf/check.sh [ -g | -b ]"; exit 1 ;;
+esac
+
+now() {
+  date +%s.%N
+}
+
+# bound <hs|lcr|-> <ring size>: the most messages the algorithm may send,
+# the message totals lap included
+bound() {
+  awk -v a="$1" -v n="$2" 'BEGIN {
+    if (a == "hs") { l = 0; while (2 ^ l < n) l++; printf "%.0f\n", 8 * n * l + n }   # hs.c header
+    else if (a == "lcr") printf "%.0f\n", n * (n + 1) / 2 + n          # descending uids
+    else print -1
+  }'
+}
+
+# baseline_time <key>: the recorded seconds for a point, empty if none
+baseline_time() {
+  [ -f $BASELINE ] || return
+  awk -v k="$1" '{ t = $1; $1 = ""; sub(/^ /, ""); if ($0 == k) print t }' $BASELINE
+}
+
+failed=0
+points=0
+: > $OUT.golden
+: > $OUT.baseline
+
+# A golden line, columns aligned
+golden_line() {
+  printf '%-17s %3s %5s %-11s %-7s %s\n' "$@" | sed 's/ *$//'
+}
+
+recorded=0
+while IFS= read -r line; do
+  case "$line" in ""|"#"*) echo "$line" >> $OUT.golden; continue ;; esac
+  set -f; set -- $line; set +f
+  prog=$1 nfg=$2 np=$3 alg=$4 tsent=$5
+  shift 5
+  args="$*"
+  points=$((points + 1))
+  key="$prog $nfg $np $args"
+  ring=${alg#*:}
+  [ "$ring" = "$alg" ] && ring=$((nfg * np))
+  limit=$(bound "${alg%%:*}" $ring)
+
+  # why fails every mode; drift (counts against golden) fails all but -g, and
+  # slow (time against the baseline) only a check
+  counts="" best="" why="" drift="" slow=""
+  rep=0
+  while [ $rep -lt $REPS ]; do
+    rep=$((rep + 1))
+    t0=$(now)
+    case "$prog" in
+      shim/*) set -- ./$prog -np $((nfg * np)) ;;
+      *) set -- $MPIEXEC -nfg $nfg -n $np ./$prog ;;
+    esac
+    timeout -s KILL $TIMEOUT "$@" $args > $OUT.run 2>&1 < /dev/null
+    rc=$?
+    t1=$(now)
+    leaders=$(grep -c '^Leader:' $OUT.run)
+    if [ $rc -ne 0 ] || [ "$leaders" -ne 1 ]; then
+      why="run $rep exited with $rc and printed $leaders Leader lines"
+      sed 's/^/    /' $OUT.run | tail -5
+      break
+    fi
+    counts="$counts $(sed -n 's/^Leader:.* tsent=\([0-9]*\).*/\1/p' $OUT.run)"
+    best=$(awk -v a="$best" -v t="$(awk -v a=$t0 -v b=$t1 'BEGIN { print b - a }')" \
+               'BEGIN { print (a == "" || t < a) ? t : a }')
+  done
+
+  if [ -z "$why" ]; then
+    lo=$(echo $counts | tr ' ' '\n' | sort -n | head -1)
+    hi=$(echo $counts | tr ' ' '\n' | sort -n | tail -1)
+    if [ "$tsent" != "*" ]; then
+      [ $lo -eq $hi ] || why="tsent$counts varies between runs"
+      [ $lo -eq $tsent ] && [ $hi -eq $tsent ] || drift="tsent$counts differs from the golden $tsent"
+    fi
+    [ $limit -lt 0 ] || [ $hi -le $limit ] || why="${why:+$why; }tsent $hi is above the $alg bound $limit"
+  fi
+
+  # The golden line this run would write
+  new=$tsent
+  [ -z "$counts" ] || [ "$tsent" = "*" ] || new=$hi
+  golden_line $prog $nfg $np $alg "$new" "$args" >> $OUT.golden
+
+  # A check keeps the recorded times and only adds missing ones
+  base=$(baseline_time "$key")
+  if [ -n "$base" ] && [ $mode = check -o -z "$best" ]; then
+    echo "$base $key" >> $OUT.baseline
+  elif [ -n "$best" ]; then
+    echo "$best $key" >> $OUT.baseline
+    [ -n "$base" ] || recorded=$((recorded + 1))
+  fi
+  if [ -n "$base" ] && [ -n "$best" ] &&
+     awk -v t=$best -v b=$base -v p=$TOLERANCE -v s=$SLACK 'BEGIN { exit !(t > b * (1 + p / 100) + s) }'; then
+    slow="best time ${best}s is over ${TOLERANCE}% + ${SLACK}s above the baseline ${base}s"
+  fi
+
+  [ $mode = golden ] || [ -z "$drift" ] || why="${why:+$why; }$drift"
+  [ $mode != check ] || [ -z "$slow" ] || why="${why:+$why; }$slow"
+  if [ -n "$why" ]; then
+    failed=$((failed + 1))
+    echo "FAIL $key: $why"
+  else
+    echo "ok   $key: tsent$counts (golden $tsent, bound $limit), best ${best}s (baseline ${base:-recorded now})"
+  fi
+done < $GOLDEN
+
+case $failed$mode in
+  0golden) cp $OUT.golden $GOLDEN && echo "Rewrote $GOLDEN" ;;
+  0baseline) cp $OUT.baseline $BASELINE && echo "Rewrote $BASELINE" ;;
+  *check) [ $recorded -eq 0 ] || { cp $OUT.baseline $BASELINE && echo "Recorded $recorded times in $BASELINE"; } ;;
+esac
+rm -f $OUT.run $OUT.golden $OUT.baseline
+
+echo "Perf: points=$points, reps=$REPS, tolerance=${TOLERANCE}%+${SLACK}s, failed=$failed"
+[ $failed -eq 0 ]
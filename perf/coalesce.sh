@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# coalesce.sh
+#
+# Usage:
+# sh perf/coalesce.sh [ <arguments> ]     (make perf-coalesce)
+#
+# What per-link batching (-c, common/coalesce.h) buys hs for each
+# co-location factor. Runs
+#   $MPIEXEC -nfg <nfg> -n $PERF_N ./hs -c <budget> <arguments>
+# (PERF_N defaults to 4)
+# for nfg in PERF_NFG (default 1 4 16 64) and every budget in PERF_COALESCE
+# (default 4 16 16:1 16:4), plus -c 1, which sends every message as it is
+# made and is the baseline. Each runs PERF_REPS times (default 3) and the
+# one with the lowest latency counts. For each budget it prints the
+# Coalesce line, then against the baseline: the ratio of messages to MPI
+# messages, the change in MPI messages, the gain in messages handled per
+# second of election and the latency added.
+# arguments default to -u bitrev.
+
+cd "$(dirname "$0")/.." || exit 1
+
+MPIEXEC=${MPIEXEC:-mpiexec}
+N=${PERF_N:-4}
+NFG=${PERF_NFG:-1 4 16 64}
+BUDGETS=${PERF_COALESCE:-4 16 16:1 16:4}
+REPS=${PERF_REPS:-3}
+TIMEOUT=${PERF_TIMEOUT:-60}
+OUT=${TMPDIR:-/tmp}/perf-coalesce.$$
+
+if [ $# -eq 0 ]; then set -- -u bitrev; fi
+
+for nfg in $NFG; do
+  for c in 1 $BUDGETS; do
+    rep=0
+    while [ $rep -lt $REPS ]; do
+      rep=$((rep + 1))
+      timeout -s KILL $TIMEOUT $MPIEXEC -nfg $nfg -n $N ./hs -c $c "$@" > $OUT 2>&1 < /dev/null
+      grep '^Coalesce:' $OUT || { echo "FAIL -nfg $nfg -c $c"; sed 's/^/    /' $OUT | tail -5; }
+    done | awk -v nfg=$nfg '
+      /^FAIL/ || /^    / { print; next }
+      { match($0, /latency=[0-9.]+/); lat = substr($0, RSTART + 8, RLENGTH - 8) + 0
+        if (line == "" || lat < best) { best = lat; line = $0 } }
+      END { if (line != "") print "Coalesce -nfg " nfg ": " substr(line, 11) }'
+  done
+done | awk '
+  function field(name) { return match($0, name "=[0-9.]+") ? substr($0, RSTART + length(name) + 1, RLENGTH - length(name) - 1) + 0 : 0 }
+  /^Coalesce -nfg/ {
+    print
+    nfg = $3; msgs = field("msgs"); wire = field("wire"); lat = field("latency")
+    if (field("max") == 1 && field("polls") == 0) { bwire[nfg] = wire; brate[nfg] = lat > 0 ? msgs / lat : 0; blat[nfg] = lat; next }
+    if (!(nfg in bwire)) next
+    rate = lat > 0 ? msgs / lat : 0
+    printf("Gain -nfg %s -c %s: ratio=%.2f, wire=%+.1f%%, rate=%.2fx, added_latency=%+.6f\n", substr(nfg, 1, length(nfg) - 1),
+           field("max") ":" field("polls"), wire > 0 ? msgs / wire : 1, bwire[nfg] > 0 ? 100 * (wire - bwire[nfg]) / bwire[nfg] : 0,
+           brate[nfg] > 0 ? rate / brate[nfg] : 1, lat - blat[nfg])
+    next
+  }
+  { print }'
+rm -f $OUT
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# density.sh
+#
+# Usage:
+# sh perf/density.sh     (make perf-density)
+#
+# How many co-located processes fit per OS process. For every point below it
+# finds, by bisection between 1 and 64 KB, the smallest per-process stack
+# (SHIM_STACK) the shim build runs the election in, a run counting when it
+# exits cleanly with one Leader line, and then runs it once more with -m at
+# the default 64 KB for the measured stack high-water mark and the election
+# state. Stack is what every co-located process costs its OS process, so a
+# smaller one is the same factor more processes in the same memory; the
+# Density line gives both. Needs make shim.
+
+cd "$(dirname "$0")/.." || exit 1
+
+TIMEOUT=${PERF_TIMEOUT:-60}
+DEFAULT_KB=64
+OUT=${TMPDIR:-/tmp}/perf-density.$$
+
+# <program> <processes> <arguments>, as in perf/golden
+POINTS="hs 16384 -u bitrev
+hs-random 16384 -u arith -s 3 114689
+hs-passthru 1024 -s 3 7169
+lcr 16384 114689
+lcr-random 16384 -u arith -s 3 114689
+lcr-passthru 16384 114689"
+
+# runs <stack KB> <program> <processes> <arguments>: whether the election ran
+runs() {
+  kb=$1 prog=$2 np=$3
+  shift 3
+  SHIM_STACK=$kb timeout -s KILL $TIMEOUT ./shim/$prog -np $np "$@" > $OUT 2>&1 < /dev/null &&
+    [ "$(grep -c '^Leader:' $OUT)" -eq 1 ]
+}
+
+echo "$POINTS" | while read -r prog np args; do
+  if ! runs $DEFAULT_KB $prog $np $args; then
+    echo "FAIL $prog $np $args: doesn't run at the default ${DEFAULT_KB} KB"
+    sed 's/^/    /' $OUT | tail -5
+    continue
+  fi
+  lo=0 hi=$DEFAULT_KB   # lo fails, hi runs
+  while [ $((hi - lo)) -gt 1 ]; do
+    mid=$(((lo + hi) / 2))
+    if runs $mid $prog $np $args; then hi=$mid; else lo=$mid; fi
+  done
+  runs $DEFAULT_KB $prog $np -m $args
+  # The passthru programs keep no state and report forwarder and election
+  # stacks apart; the election's is the larger
+  awk -v p="$prog" -v np=$np -v a="$args" -v kb=$hi -v d=$DEFAULT_KB '/^Memory:/ {
+    line = $0
+    stack = line; sub(/.*stack=/, "", stack); mean = stack + 0; sub(/^[0-9]+ \(max /, "", stack); max = stack + 0
+    st = 0; if (sub(/.*state_bytes=/, "", line)) st = line + 0
+    printf "Density: %s -np %d %s: stack_kb=%d (default %d), stack_bytes=%d (max %d), state_bytes=%d, ", p, np, a, kb, d, mean, max, st
+    printf "procs_per_gb=%d (default %d), gain=%.1fx\n", 1048576 / kb, 1048576 / d, d / kb
+  }' $OUT
+done
+rm -f $OUT
@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# normalize.sh
+#
+# Usage:
+# sh perf/normalize.sh <colocbench table> [ <election output> ]
+#
+# Election times in hops, so runs at different -nfg and -n compare. The
+# table is what colocbench -f wrote for the same -nfg and -n; its token row
+# gives the seconds a hop. The times on the election's Timing line (-t) and
+# the latency on its Recv line (-w) get a _hops copy divided by that. Every
+# other line passes through. The election output is read from stdin if not
+# given.
+
+if [ $# -lt 1 ] || [ $# -gt 2 ] || [ ! -f "$1" ]; then
+  echo "Usage: sh perf/normalize.sh <colocbench table> [ <election output> ]"
+  exit 1
+fi
+
+awk 'NR == FNR { if ($1 == "token") hop = $5; next }
+  FNR == 1 && !hop { print "normalize.sh: no token row in " ARGV[1] > "/dev/stderr"; exit 1 }
+  /^Timing: to_leader=/ || /^Recv:/ {
+    out = ""; line = $0
+    while (match(line, /(to_leader|to_quiescence|leader_to_quiescence|latency)=[0-9.e+-]+/)) {
+      split(substr(line, RSTART, RLENGTH), kv, "=")
+      out = out ", " kv[1] "_hops=" sprintf("%.1f", kv[2] / hop)
+      line = substr(line, RSTART + RLENGTH)
+    }
+    print $0 out
+    next
+  }
+  { print }' "$1" "${2:--}"
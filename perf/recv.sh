@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# recv.sh
+#
+# Usage:
+# sh perf/recv.sh [ <program> [ <arguments> ] ]     (make perf-recv)
+#
+# CPU cost of each receive strategy (-w, common/recv.h) for each co-location
+# factor. Runs
+#   $MPIEXEC -nfg <nfg> -n $PERF_N ./<program> -w <strategy> <arguments>
+# (PERF_N defaults to 4)
+# for nfg in PERF_NFG (default 1 4 16 64) and every strategy in PERF_RECV
+# (default block poll:1 poll:64 spin; spin only at -nfg 1), PERF_REPS times
+# each (default 3), and prints the best CPU time, context switches and
+# latency of each, then the cheapest strategy by CPU time per rank for each
+# nfg.
+# program defaults to hs -u bitrev; lcr needs its process number.
+
+cd "$(dirname "$0")/.." || exit 1
+
+MPIEXEC=${MPIEXEC:-mpiexec}
+N=${PERF_N:-4}
+NFG=${PERF_NFG:-1 4 16 64}
+STRATEGIES=${PERF_RECV:-block poll:1 poll:64 spin}
+REPS=${PERF_REPS:-3}
+TIMEOUT=${PERF_TIMEOUT:-60}
+OUT=${TMPDIR:-/tmp}/perf-recv.$$
+
+if [ $# -eq 0 ]; then set -- hs -u bitrev; fi
+prog=$1
+shift
+
+: > $OUT.best
+for nfg in $NFG; do
+  for w in $STRATEGIES; do
+    [ $w = spin ] && [ $nfg -gt 1 ] && continue
+    rep=0
+    while [ $rep -lt $REPS ]; do
+      rep=$((rep + 1))
+      timeout -s KILL $TIMEOUT $MPIEXEC -nfg $nfg -n $N ./$prog -w $w "$@" > $OUT 2>&1 < /dev/null
+      grep '^Recv:' $OUT || { echo "FAIL -nfg $nfg -w $w"; sed 's/^/    /' $OUT | tail -5; }
+    done | awk -v nfg=$nfg -v w=$w -v f=$OUT.best '
+      /^FAIL/ || /^    / { print; next }
+      { match($0, /cpu_s_per_rank=[0-9.]+/); cpu = substr($0, RSTART + 15, RLENGTH - 15) + 0
+        if (line == "" || cpu < best) { best = cpu; line = $0 } }
+      END { if (line != "") { print "Recv -nfg " nfg ": " substr(line, 7); print nfg, w, best >> f } }'
+  done
+done
+sort -k1,1n -k3,3g $OUT.best | awk '!seen[$1]++ { printf "Cheapest -nfg %d: %s (cpu_s_per_rank=%s)\n", $1, $2, $3 }'
+rm -f $OUT $OUT.best
@@ -0,0 +1,399 @@
+/**
+ * pmpi-prof.c
+ *
+ * PMPI interposition profiler for the election programs. Build them with
+ *
+ *   make PROFILE=1
+ *
+ * and every MPI_Isend, MPI_Send, MPI_Irecv, MPI_Recv, MPI_Request_free,
+ * MPI_Wait, MPI_Waitany, MPI_Waitall, MPI_Test and MPI_Testall goes through
+ * the wrappers below first. Nothing in the programs changes.
+ *
+ * Per process it counts calls and bytes per tag and per peer, the time spent
+ * blocked in MPI_Recv and in the waits, and requests from MPI_Isend that are
+ * still outstanding (not completed by a wait or MPI_Test, or handed to
+ * MPI_Request_free); the most outstanding at once is kept as a high-water
+ * mark. MPI_Finalize reduces all of it onto rank 0, which prints one merged
+ * summary.
+ *
+ * Requests from MPI_Isend and MPI_Irecv are kept in a hash table per process,
+ * keyed by handle and grown as needed, so a completion is matched to its
+ * request: it ends an Isend, or it counts an Irecv's message under the tag
+ * and source in its status. The programs leave many Isends pending (lcr never
+ * completes its election sends), so the table can hold thousands. Requests
+ * that don't fit because the table can't grow are counted as untracked, and
+ * the high-water mark is then not printed, as it would only be a lower bound.
+ *
+ * Tags are counted across all communicators together. Peers are merged by
+ * signed ring distance, (peer - rank) folded into (-size/2, size/2], in
+ * power-of-two buckets: +1 is "right", -1 is "left".
+ *
+ * FG-MPI co-locates many MPI processes in one OS process, and globals are
+ * shared between them, so the counters live in a table with one slot per
+ * co-located process, indexed by world rank - collocated start rank.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+
+#define PROF_MAX_TAGS 64  // tags >= this (and MPI_ANY_TAG) share the last bin
+#define PROF_DIST_BINS 65 // -32..32: sign * (floor(log2 |distance|) + 1)
+#define PROF_PENDING 64   // initial slots in a process's request table, doubled as it fills
+#define PROF_WAIT_LOCAL 16 // requests a wait copies on the stack; more are malloc'ed
+
+typedef struct {
+  MPI_Request req;
+  MPI_Comm comm;
+  int recv; // from MPI_Irecv, else from MPI_Isend
+} prof_pending_t;
+
+typedef struct {
+  long long sends[PROF_MAX_TAGS], recvs[PROF_MAX_TAGS];
+  long long bytes_sent[PROF_MAX_TAGS];
+  long long peer_sends[PROF_DIST_BINS], peer_recvs[PROF_DIST_BINS];
+  long long isends, sends_blocking, irecvs, recv_calls, frees, completions, untracked;
+  long long outstanding, outstanding_max;
+  double recv_blocked, wait_blocked;
+  int rank, size;
+  int npending, cap;       // cap is 0 or a power of two
+  prof_pending_t *pending; // open addressing, empty slots hold MPI_REQUEST_NULL
+} prof_counters_t;
+
+static prof_counters_t *table = NULL; // one slot per co-located process
+static int table_start, table_users;
+
+static prof_counters_t *self(void) {
+  int rank;
+  PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  return &table[rank - table_start];
+}
+
+static int tag_bin(int tag) {
+  return (tag < 0 || tag >= PROF_MAX_TAGS) ? PROF_MAX_TAGS - 1 : tag;
+}
+
+static int dist_bin(const prof_counters_t *c, MPI_Comm comm, int peer) {
+  int wpeer = peer, b = 0;
+  MPI_Group g, world;
+
+  if (peer < 0) return PROF_DIST_BINS / 2; // MPI_ANY_SOURCE, MPI_PROC_NULL
+  if (comm != MPI_COMM_WORLD) {
+    // Translate to world rank so distances mean the same on every communicator
+    PMPI_Comm_group(comm, &g);
+    PMPI_Comm_group(MPI_COMM_WORLD, &world);
+    PMPI_Group_translate_ranks(g, 1, &peer, world, &wpeer);
+    PMPI_Group_free(&g);
+    PMPI_Group_free(&world);
+  }
+
+  int d = (wpeer - c->rank + c->size) % c->size;
+  if (d > c->size / 2) d -= c->size;
+  int a = d < 0 ? -d : d;
+  while (a) b++, a >>= 1;
+  return PROF_DIST_BINS / 2 + (d < 0 ? -b : b);
+}
+
+static void count_send(MPI_Datatype type, int count, int dest, int tag, MPI_Comm comm) {
+  prof_counters_t *c = self();
+  int tsize;
+  PMPI_Type_size(type, &tsize);
+  c->sends[tag_bin(tag)]++;
+  c->bytes_sent[tag_bin(tag)] += (long long) tsize * count;
+  c->peer_sends[dist_bin(c, comm, dest)]++;
+}
+
+static void count_recv(prof_counters_t *c, MPI_Comm comm, const MPI_Status *status) {
+  c->recvs[tag_bin(status->MPI_TAG)]++;
+  c->peer_recvs[dist_bin(c, comm, status->MPI_SOURCE)]++;
+}
+
+/** Home slot of a request handle (an int or a pointer, depending on the MPI). */
+static int slot_of(const prof_counters_t *c, MPI_Request req) {
+  unsigned char b[sizeof(MPI_Request)];
+  unsigned h = 2166136261u; // FNV-1a
+  size_t i;
+
+  memcpy(b, &req, sizeof(req));
+  for (i = 0; i < sizeof(req); i++) h = (h ^ b[i]) * 16777619u;
+  return (int) (h & (unsigned) (c->cap - 1));
+}
+
+static void insert(prof_counters_t *c, const prof_pending_t *p) {
+  int i = slot_of(c, p->req);
+  while (c->pending[i].req != MPI_REQUEST_NULL) i = (i + 1) & (c->cap - 1);
+  c->pending[i] = *p;
+  c->npending++;
+}
+
+/** Doubles the table (kept at most half full); returns 0 if out of memory. */
+static int grow(prof_counters_t *c) {
+  prof_pending_t *old = c->pending;
+  int oldcap = c->cap, i;
+  int cap = oldcap ? 2 * oldcap : PROF_PENDING;
+
+  prof_pending_t *t = malloc(cap * sizeof(*t));
+  if (!t) return 0;
+  for (i = 0; i < cap; i++) t[i].req = MPI_REQUEST_NULL;
+  c->pending = t, c->cap = cap, c->npending = 0;
+  for (i = 0; i < oldcap; i++) {
+    if (old[i].req != MPI_REQUEST_NULL) insert(c, &old[i]);
+  }
+  free(old);
+  return 1;
+}
+
+static void track(prof_counters_t *c, MPI_Request req, MPI_Comm comm, int recv) {
+  if (2 * (c->npending + 1) > c->cap && !grow(c)) {
+    c->untracked++;
+    return;
+  }
+  insert(c, &(prof_pending_t) { .req = req, .comm = comm, .recv = recv });
+  if (!recv && ++c->outstanding > c->outstanding_max) c->outstanding_max = c->outstanding;
+}
+
+/** Drops req from the table; returns its entry in *p, or 0 if it wasn't tracked. */
+static int untrack(prof_counters_t *c, MPI_Request req, prof_pending_t *p) {
+  int mask = c->cap - 1, i, j, k;
+
+  if (!c->cap) return 0;
+  for (i = slot_of(c, req); c->pending[i].req != req; i = (i + 1) & mask) {
+    if (c->pending[i].req == MPI_REQUEST_NULL) return 0;
+  }
+  *p = c->pending[i];
+  c->npending--;
+  if (!p->recv) c->outstanding--;
+
+  // Shift later entries of the probe run back so every lookup still finds them
+  for (j = (i + 1) & mask; c->pending[j].req != MPI_REQUEST_NULL; j = (j + 1) & mask) {
+    k = slot_of(c, c->pending[j].req);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      c->pending[i] = c->pending[j];
+      i = j;
+    }
+  }
+  c->pending[i].req = MPI_REQUEST_NULL;
+  return 1;
+}
+
+/** req, its handle from before the wait or test, has completed with status. */
+static void completed(prof_counters_t *c, MPI_Request req, const MPI_Status *status) {
+  prof_pending_t p;
+  int cancelled;
+
+  if (!untrack(c, req, &p)) return;
+  if (!p.recv) {
+    c->completions++;
+    return;
+  }
+  PMPI_Test_cancelled(status, &cancelled);
+  if (!cancelled) count_recv(c, p.comm, status);
+}
+
+int MPI_Init(int *argc, char ***argv) {
+  int rc = PMPI_Init(argc, argv), colsize, rank;
+
+  if (!table) {
+    MPIX_Get_collocated_size(&colsize);
+    MPIX_Get_collocated_startrank(&table_start);
+    table = calloc(colsize, sizeof(*table));
+  }
+  table_users++;
+
+  prof_counters_t *c = self();
+  PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  c->rank = rank;
+  PMPI_Comm_size(MPI_COMM_WORLD, &c->size);
+
+  return rc;
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request *req) {
+  prof_counters_t *c = self();
+  count_send(type, count, dest, tag, comm);
+  c->isends++;
+  int rc = PMPI_Isend(buf, count, type, dest, tag, comm, req);
+  track(c, *req, comm, 0);
+  return rc;
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+  count_send(type, count, dest, tag, comm);
+  self()->sends_blocking++;
+  return PMPI_Send(buf, count, type, dest, tag, comm);
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Status *status) {
+  MPI_Status local;
+  if (status == MPI_STATUS_IGNORE) status = &local;
+
+  double t0 = PMPI_Wtime();
+  int rc = PMPI_Recv(buf, count, type, source, tag, comm, status);
+  double blocked = PMPI_Wtime() - t0;
+
+  // Look the slot up afterwards: other co-located processes ran while we were blocked
+  prof_counters_t *c = self();
+  c->recv_blocked += blocked;
+  c->recv_calls++;
+  count_recv(c, comm, status);
+  return rc;
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Request *req) {
+  prof_counters_t *c = self();
+  c->irecvs++;
+  int rc = PMPI_Irecv(buf, count, type, source, tag, comm, req);
+  track(c, *req, comm, 1);
+  return rc;
+}
+
+int MPI_Request_free(MPI_Request *req) {
+  prof_counters_t *c = self();
+  prof_pending_t p;
+  c->frees++;
+  untrack(c, *req, &p);
+  return PMPI_Request_free(req);
+}
+
+int MPI_Wait(MPI_Request *req, MPI_Status *status) {
+  MPI_Status local;
+  MPI_Request r = *req;
+  if (status == MPI_STATUS_IGNORE) status = &local;
+
+  double t0 = PMPI_Wtime();
+  int rc = PMPI_Wait(req, status);
+  double blocked = PMPI_Wtime() - t0;
+
+  prof_counters_t *c = self();
+  c->wait_blocked += blocked;
+  if (r != MPI_REQUEST_NULL) completed(c, r, status);
+  return rc;
+}
+
+int MPI_Waitany(int count, MPI_Request reqs[], int *index, MPI_Status *status) {
+  MPI_Status local;
+  MPI_Request saved[PROF_WAIT_LOCAL], *r = count > PROF_WAIT_LOCAL ? malloc(count * sizeof(MPI_Request)) : saved;
+  if (status == MPI_STATUS_IGNORE) status = &local;
+  memcpy(r, reqs, count * sizeof(MPI_Request));
+
+  double t0 = PMPI_Wtime();
+  int rc = PMPI_Waitany(count, reqs, index, status);
+  double blocked = PMPI_Wtime() - t0;
+
+  prof_counters_t *c = self();
+  c->wait_blocked += blocked;
+  if (*index != MPI_UNDEFINED) completed(c, r[*index], status);
+  if (r != saved) free(r);
+  return rc;
+}
+
+int MPI_Waitall(int count, MPI_Request reqs[], MPI_Status statuses[]) {
+  int i;
+  MPI_Status slocal[PROF_WAIT_LOCAL], *s = statuses;
+  MPI_Request saved[PROF_WAIT_LOCAL], *r = count > PROF_WAIT_LOCAL ? malloc(count * sizeof(MPI_Request)) : saved;
+  if (statuses == MPI_STATUSES_IGNORE) s = count > PROF_WAIT_LOCAL ? malloc(count * sizeof(MPI_Status)) : slocal;
+  memcpy(r, reqs, count * sizeof(MPI_Request));
+
+  double t0 = PMPI_Wtime();
+  int rc = PMPI_Waitall(count, reqs, s);
+  double blocked = PMPI_Wtime() - t0;
+
+  prof_counters_t *c = self();
+  c->wait_blocked += blocked;
+  for (i = 0; i < count; i++) {
+    if (r[i] != MPI_REQUEST_NULL) completed(c, r[i], &s[i]);
+  }
+  if (r != saved) free(r);
+  if (s != statuses && s != slocal) free(s);
+  return rc;
+}
+
+int MPI_Test(MPI_Request *req, int *flag, MPI_Status *status) {
+  MPI_Status local;
+  MPI_Request r = *req;
+  if (status == MPI_STATUS_IGNORE) status = &local;
+
+  int rc = PMPI_Test(req, flag, status);
+  prof_counters_t *c = self();
+  if (r != MPI_REQUEST_NULL && *flag) completed(c, r, status);
+  return rc;
+}
+
+int MPI_Testall(int count, MPI_Request reqs[], int *flag, MPI_Status statuses[]) {
+  int i;
+  MPI_Status slocal[PROF_WAIT_LOCAL], *s = statuses;
+  MPI_Request saved[PROF_WAIT_LOCAL], *r = count > PROF_WAIT_LOCAL ? malloc(count * sizeof(MPI_Request)) : saved;
+  if (statuses == MPI_STATUSES_IGNORE) s = count > PROF_WAIT_LOCAL ? malloc(count * sizeof(MPI_Status)) : slocal;
+  memcpy(r, reqs, count * sizeof(MPI_Request));
+
+  int rc = PMPI_Testall(count, reqs, flag, s);
+  prof_counters_t *c = self();
+  for (i = 0; *flag && i < count; i++) {
+    if (r[i] != MPI_REQUEST_NULL) completed(c, r[i], &s[i]);
+  }
+  if (r != saved) free(r);
+  if (s != statuses && s != slocal) free(s);
+  return rc;
+}
+
+static void print_summary(const prof_counters_t *sum, const double blocked_max[2], long long outstanding_max, int size) {
+  int i;
+
+  printf("PMPI: %d processes, isend=%lld send=%lld irecv=%lld recv=%lld request_free=%lld completed=%lld\n",
+         size, sum->isends, sum->sends_blocking, sum->irecvs, sum->recv_calls, sum->frees, sum->completions);
+  printf("PMPI: recv blocked total=%.6f mean=%.6f max=%.6f s\n",
+         sum->recv_blocked, sum->recv_blocked / size, blocked_max[0]);
+  printf("PMPI: wait blocked total=%.6f mean=%.6f max=%.6f s\n",
+         sum->wait_blocked, sum->wait_blocked / size, blocked_max[1]);
+  if (sum->untracked) {
+    printf("PMPI: requests outstanding at finalize>=%lld, most at once not known, untracked=%lld\n",
+           sum->outstanding, sum->untracked);
+  } else {
+    printf("PMPI: requests outstanding at finalize=%lld, most at once in one process=%lld\n",
+           sum->outstanding, outstanding_max);
+  }
+
+  printf("PMPI: %6s %12s %12s %14s\n", "tag", "sent", "received", "bytes sent");
+  for (i = 0; i < PROF_MAX_TAGS; i++) {
+    if (!sum->sends[i] && !sum->recvs[i]) continue;
+    if (i == PROF_MAX_TAGS - 1) printf("PMPI: %6s", "other");
+    else printf("PMPI: %6d", i);
+    printf(" %12lld %12lld %14lld\n", sum->sends[i], sum->recvs[i], sum->bytes_sent[i]);
+  }
+
+  printf("PMPI: %13s %12s %12s\n", "ring distance", "sent", "received");
+  for (i = 0; i < PROF_DIST_BINS; i++) {
+    int b = i - PROF_DIST_BINS / 2;
+    if (!sum->peer_sends[i] && !sum->peer_recvs[i]) continue;
+    if (b == 0) printf("PMPI: %13s", "any/self");
+    else if (b == 1 || b == -1) printf("PMPI: %13s", b > 0 ? "+1" : "-1");
+    else printf("PMPI: %c[%lld,%lld)", b > 0 ? '+' : '-', 1ll << (abs(b) - 1), 1ll << abs(b));
+    printf(" %12lld %12lld\n", sum->peer_sends[i], sum->peer_recvs[i]);
+  }
+}
+
+int MPI_Finalize(void) {
+  prof_counters_t *c = self(), sum;
+  double blocked_max[2];
+  long long outstanding_max;
+
+  // Every field before rank/size is a long long or one of the two doubles, reduced by sum
+  int nll = (int) (offsetof(prof_counters_t, recv_blocked) / sizeof(long long));
+  PMPI_Reduce(c, &sum, nll, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+  PMPI_Reduce(&c->recv_blocked, &sum.recv_blocked, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  PMPI_Reduce(&c->recv_blocked, blocked_max, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  PMPI_Reduce(&c->outstanding_max, &outstanding_max, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  if (!c->rank) print_summary(&sum, blocked_max, outstanding_max, c->size);
+  free(c->pending);
+
+  if (--table_users == 0) {
+    free(table);
+    table = NULL;
+  }
+
+  return PMPI_Finalize();
+}
@@ -0,0 +1,24 @@
+/**
+ * fgmpi.h (shim)
+ *
+ * FG-MPI's process-launch interface for the shim: FGmpiexec() starts one
+ * coroutine per rank, all co-located in this OS process. The rank count comes
+ * from a leading "-np N" argument (or SHIM_NP), in place of mpiexec -nfg/-n.
+ */
+
+#ifndef SHIM_FGMPI_H
+#define SHIM_FGMPI_H
+
+#include "mpi.h"
+
+typedef int (*FG_ProcessPtr_t)(int argc, char **argv);
+typedef FG_ProcessPtr_t (*FG_MapPtr_t)(int argc, char **argv, int rank);
+typedef FG_MapPtr_t (*FG_LookupPtr_t)(int argc, char **argv, char *str);
+
+int FGmpiexec(int *argc, char ***argv, FG_LookupPtr_t lookup);
+
+int MPIX_Get_collocated_size(int *size);
+int MPIX_Get_collocated_startrank(int *startrank);
+int MPIX_Yield(void);
+
+#endif
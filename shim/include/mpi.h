@@ -0,0 +1,89 @@
+/**
+ * mpi.h (shim)
+ *
+ * The subset of MPI used by the election programs, implemented by shim.c on
+ * user-level coroutines in a single OS process. Not a general MPI: every send
+ * is eager, collectives are rendezvous points between coroutines (MPI_Ibcast
+ * excepted, which is point to point underneath), and only the datatypes and
+ * reduction operations the programs use exist.
+ */
+
+#ifndef SHIM_MPI_H
+#define SHIM_MPI_H
+
+typedef int MPI_Comm;
+typedef int MPI_Datatype;
+typedef int MPI_Op;
+typedef int MPI_Info;
+typedef int MPI_File;
+typedef long long MPI_Offset;
+typedef struct shim_request *MPI_Request;
+
+typedef struct {
+  int MPI_SOURCE;
+  int MPI_TAG;
+  int MPI_ERROR;
+  int count; // bytes
+} MPI_Status;
+
+#define MPI_SUCCESS 0
+#define MPI_ERR_OTHER 15
+
+#define MPI_COMM_WORLD 0
+#define MPI_COMM_NULL (-1)
+#define MPI_ANY_SOURCE (-2)
+#define MPI_ANY_TAG (-1)
+#define MPI_PROC_NULL (-3)
+#define MPI_REQUEST_NULL ((MPI_Request) 0)
+#define MPI_STATUS_IGNORE ((MPI_Status *) 0)
+#define MPI_STATUSES_IGNORE ((MPI_Status *) 0)
+#define MPI_INFO_NULL 0
+#define MPI_UNDEFINED (-32766)
+
+#define MPI_CHAR 1
+#define MPI_INT 2
+#define MPI_DOUBLE 3
+#define MPI_LONG_LONG 4
+#define MPI_UNSIGNED 5
+
+#define MPI_SUM 1
+#define MPI_MIN 2
+#define MPI_MAX 3
+
+#define MPI_MODE_RDONLY 2
+#define MPI_MODE_RDWR 8
+#define MPI_MODE_WRONLY 4
+#define MPI_MODE_CREATE 1
+
+int MPI_Init(int *argc, char ***argv);
+int MPI_Initialized(int *flag);
+int MPI_Finalize(void);
+int MPI_Comm_rank(MPI_Comm comm, int *rank);
+int MPI_Comm_size(MPI_Comm comm, int *size);
+double MPI_Wtime(void);
+
+int MPI_Send(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm);
+int MPI_Isend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request *req);
+int MPI_Recv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Status *status);
+int MPI_Irecv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Request *req);
+int MPI_Request_free(MPI_Request *req);
+int MPI_Cancel(MPI_Request *req);
+int MPI_Wait(MPI_Request *req, MPI_Status *status);
+int MPI_Waitall(int count, MPI_Request *reqs, MPI_Status *statuses);
+int MPI_Waitany(int count, MPI_Request *reqs, int *index, MPI_Status *status);
+int MPI_Test(MPI_Request *req, int *flag, MPI_Status *status);
+int MPI_Iprobe(int source, int tag, MPI_Comm comm, int *flag, MPI_Status *status);
+
+int MPI_Barrier(MPI_Comm comm);
+int MPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm);
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, MPI_Comm comm);
+int MPI_Ibcast(void *buf, int count, MPI_Datatype type, int root, MPI_Comm comm, MPI_Request *req);
+int MPI_Comm_dup(MPI_Comm comm, MPI_Comm *newcomm);
+int MPI_Comm_free(MPI_Comm *comm);
+
+int MPI_File_open(MPI_Comm comm, const char *path, int amode, MPI_Info info, MPI_File *fh);
+int MPI_File_set_size(MPI_File fh, MPI_Offset size);
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf, int count, MPI_Datatype type, MPI_Status *status);
+int MPI_File_close(MPI_File *fh);
+
+#endif
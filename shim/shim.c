@@ -0,0 +1,664 @@
+/**
+ * shim.c
+ *
+ * Runs the election programs without an MPI installation: every rank is a
+ * coroutine with a small stack in this one OS process, much like FG-MPI's
+ * co-location with -n 1 and -nfg N.
+ *
+ * Scheduling is run-until-block. The scheduler resumes the next runnable
+ * coroutine, which runs until it waits for a message that hasn't arrived,
+ * waits at a collective, calls MPIX_Yield or returns. A sender makes a receiver
+ * that is waiting runnable again; the last rank into a collective completes it
+ * for everyone and makes them all runnable. If nothing is runnable while ranks
+ * are still alive, the run has deadlocked: the shim says which ranks are stuck
+ * and exits with status 2, so regression runs can't hang.
+ *
+ * Each rank's mailbox is a lock-free LIFO that senders push onto with a CAS;
+ * the owner takes the whole list in one exchange, reverses it into its private
+ * FIFO of pending messages, and matches receives against that in arrival
+ * order. Sends are eager: the payload is copied and the send completes at once.
+ * A nonblocking receive is matched when it is waited on or tested.
+ *
+ * On x86-64 a context switch is a few register pushes and a stack swap;
+ * elsewhere it falls back to ucontext. Stacks are carved out of one
+ * MAP_NORESERVE mapping (SHIM_STACK KB each, 64 by default), with a canary at
+ * the bottom of each that is checked every time the rank is switched out.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mpi.h"
+#include "fgmpi.h"
+
+#define STACK_KB_DEFAULT 64
+#define STACK_CANARY 0x5eedc0ffee15deadull
+
+/*
+ * Contexts
+ */
+
+#if defined(__x86_64__)
+
+typedef struct { void *sp; } ctx_t;
+
+void shim_ctx_switch(void **save_sp, void *load_sp);
+__asm__(
+  ".text\n"
+  ".globl shim_ctx_switch\n"
+  ".type shim_ctx_switch, @function\n"
+  "shim_ctx_switch:\n"
+  "  pushq %rbp\n  pushq %rbx\n  pushq %r12\n  pushq %r13\n  pushq %r14\n  pushq %r15\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  popq %r15\n  popq %r14\n  popq %r13\n  popq %r12\n  popq %rbx\n  popq %rbp\n"
+  "  ret\n"
+  ".size shim_ctx_switch, .-shim_ctx_switch\n"
+);
+
+static void ctx_make(ctx_t *ctx, char *stack, size_t size, void (*fn)(void)) {
+  // Lay out what shim_ctx_switch pops: six callee-saved registers, then fn as
+  // the return address, with the stack aligned as if fn had just been called
+  void **sp = (void **) (((unsigned long) (stack + size)) & ~15ul);
+  *--sp = NULL;
+  *--sp = (void *) fn;
+  sp -= 6;
+  memset(sp, 0, 6 * sizeof(void *));
+  ctx->sp = sp;
+}
+
+static void ctx_switch(ctx_t *from, ctx_t *to) {
+  shim_ctx_switch(&from->sp, to->sp);
+}
+
+#else
+
+#include <ucontext.h>
+
+typedef ucontext_t ctx_t;
+
+static void ctx_make(ctx_t *ctx, char *stack, size_t size, void (*fn)(void)) {
+  getcontext(ctx);
+  ctx->uc_stack.ss_sp = stack;
+  ctx->uc_stack.ss_size = size;
+  ctx->uc_link = NULL;
+  makecontext(ctx, fn, 0);
+}
+
+static void ctx_switch(ctx_t *from, ctx_t *to) {
+  swapcontext(from, to);
+}
+
+#endif
+
+/*
+ * Ranks, mailboxes and the scheduler
+ */
+
+typedef struct msg {
+  struct msg *next;
+  int src, tag, ctx, len;
+  char data[];
+} msg_t;
+
+typedef enum { RUNNABLE, BLOCKED, DONE } coro_state_t;
+
+typedef struct coro {
+  ctx_t ctx;
+  char *stack;
+  int rank;
+  coro_state_t state;
+  int waiting_msg;           // blocked in a receive, so a send should wake it
+  int initialized;           // has called MPI_Init
+  struct coro *next_run;
+  FG_ProcessPtr_t fn;
+  _Atomic(msg_t *) inbox;    // pushed by senders, newest first
+  msg_t *pending, *pending_tail; // taken by the owner, oldest first
+} coro_t;
+
+// Sends complete at once and share one request; a receive gets its own,
+// matched when it is waited on or tested
+struct shim_request {
+  int done;
+  void *buf;
+  int max, src, tag, ctx;
+  MPI_Status status;
+};
+static struct shim_request completed_send = { .done = 1 };
+
+static coro_t *ranks;
+static int nranks, live;
+static coro_t *current;
+static ctx_t sched_ctx;
+static coro_t *runq_head, *runq_tail;
+static size_t stack_size;
+static int shim_argc;
+static char **shim_argv;
+
+static void make_runnable(coro_t *c) {
+  c->state = RUNNABLE;
+  c->next_run = NULL;
+  if (runq_tail) runq_tail->next_run = c;
+  else runq_head = c;
+  runq_tail = c;
+}
+
+static void to_scheduler(void) {
+  coro_t *c = current;
+  if (*(unsigned long long *) c->stack != STACK_CANARY) {
+    fprintf(stderr, "shim: rank %d overflowed its %zu KB stack (raise SHIM_STACK)\n", c->rank, stack_size / 1024);
+    abort();
+  }
+  ctx_switch(&c->ctx, &sched_ctx);
+}
+
+static void block(void) {
+  current->state = BLOCKED;
+  to_scheduler();
+}
+
+static void coro_main(void) {
+  coro_t *c = current;
+  c->fn(shim_argc, shim_argv);
+  c->state = DONE;
+  live--;
+  to_scheduler();
+}
+
+static void mailbox_push(coro_t *dest, msg_t *m) {
+  msg_t *head = atomic_load_explicit(&dest->inbox, memory_order_relaxed);
+  do {
+    m->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&dest->inbox, &head, m, memory_order_release, memory_order_relaxed));
+}
+
+static void mailbox_drain(coro_t *c) {
+  msg_t *m = atomic_exchange_explicit(&c->inbox, NULL, memory_order_acquire), *fifo = NULL, *tail;
+  if (!m) return;
+
+  tail = m;
+  while (m) {
+    msg_t *next = m->next;
+    m->next = fifo, fifo = m, m = next;
+  }
+  if (c->pending_tail) c->pending_tail->next = fifo;
+  else c->pending = fifo;
+  c->pending_tail = tail;
+}
+
+static msg_t *mailbox_match(coro_t *c, int src, int tag, int ctx) {
+  msg_t *m, *prev = NULL;
+
+  mailbox_drain(c);
+  for (m = c->pending; m; prev = m, m = m->next) {
+    if (m->ctx != ctx) continue;
+    if (src != MPI_ANY_SOURCE && m->src != src) continue;
+    if (tag != MPI_ANY_TAG && m->tag != tag) continue;
+    if (prev) prev->next = m->next;
+    else c->pending = m->next;
+    if (c->pending_tail == m) c->pending_tail = prev;
+    return m;
+  }
+  return NULL;
+}
+
+/*
+ * Communicators and collectives
+ *
+ * Every communicator is a duplicate of MPI_COMM_WORLD, so comm rank = world
+ * rank; its index doubles as the message matching context.
+ */
+
+typedef enum { COLL_BARRIER, COLL_REDUCE, COLL_ALLREDUCE, COLL_DUP } coll_kind_t;
+
+typedef struct {
+  const void *sendbuf;
+  void *recvbuf;
+  int count;
+  MPI_Datatype type;
+  MPI_Op op;
+  int root;
+  MPI_Comm *newcomm;
+  coro_t *who;
+} coll_arg_t;
+
+typedef struct {
+  int active;
+  int arrived;
+  coll_arg_t *args;
+} comm_t;
+
+static comm_t *comms;
+static int ncomms, comms_cap;
+
+static int new_comm(void) {
+  if (ncomms == comms_cap) {
+    comms_cap = comms_cap ? 2 * comms_cap : 8;
+    comms = realloc(comms, comms_cap * sizeof(*comms));
+  }
+  comms[ncomms].active = 1;
+  comms[ncomms].arrived = 0;
+  comms[ncomms].args = calloc(nranks, sizeof(coll_arg_t));
+  return ncomms++;
+}
+
+static int type_size(MPI_Datatype type) {
+  switch (type) {
+    case MPI_CHAR: return 1;
+    case MPI_INT: case MPI_UNSIGNED: return 4;
+    case MPI_DOUBLE: case MPI_LONG_LONG: return 8;
+  }
+  fprintf(stderr, "shim: unsupported datatype %d\n", type);
+  abort();
+}
+
+#define COMBINE(T) do { \
+    T *a = (T *) acc; const T *b = (const T *) in; \
+    for (i = 0; i < count; i++) { \
+      if (op == MPI_SUM) a[i] += b[i]; \
+      else if (op == MPI_MIN) { if (b[i] < a[i]) a[i] = b[i]; } \
+      else if (b[i] > a[i]) a[i] = b[i]; \
+    } \
+  } while (0)
+
+static void combine(void *acc, const void *in, int count, MPI_Datatype type, MPI_Op op) {
+  int i;
+  switch (type) {
+    case MPI_CHAR: COMBINE(char); break;
+    case MPI_INT: COMBINE(int); break;
+    case MPI_UNSIGNED: COMBINE(unsigned); break;
+    case MPI_DOUBLE: COMBINE(double); break;
+    case MPI_LONG_LONG: COMBINE(long long); break;
+  }
+}
+
+static void coll_perform(comm_t *c, coll_kind_t kind) {
+  coll_arg_t *a = c->args;
+  int i;
+
+  if (kind == COLL_DUP) {
+    int id = new_comm();
+    for (i = 0; i < nranks; i++) *a[i].newcomm = id;
+  } else if (kind == COLL_REDUCE || kind == COLL_ALLREDUCE) {
+    size_t bytes = (size_t) a[0].count * type_size(a[0].type);
+    char *acc = malloc(bytes);
+    memcpy(acc, a[0].sendbuf, bytes);
+    for (i = 1; i < nranks; i++) combine(acc, a[i].sendbuf, a[0].count, a[0].type, a[0].op);
+    for (i = 0; i < nranks; i++)
+      if (kind == COLL_ALLREDUCE || i == a[0].root) memcpy(a[i].recvbuf, acc, bytes);
+    free(acc);
+  }
+}
+
+static int collective(MPI_Comm comm, coll_kind_t kind, coll_arg_t *arg) {
+  comm_t *c = &comms[comm];
+  int i;
+
+  arg->who = current;
+  c->args[current->rank] = *arg;
+  if (++c->arrived < nranks) {
+    block();
+    return MPI_SUCCESS;
+  }
+
+  // Last one in does the work for everybody
+  coll_perform(c, kind);
+  c->arrived = 0;
+  for (i = 0; i < nranks; i++)
+    if (c->args[i].who != current) make_runnable(c->args[i].who);
+  return MPI_SUCCESS;
+}
+
+/*
+ * MPI
+ */
+
+int MPI_Init(int *argc, char ***argv) {
+  (void) argc, (void) argv;
+  current->initialized = 1;
+  return MPI_SUCCESS;
+}
+
+int MPI_Initialized(int *flag) {
+  *flag = current->initialized;
+  return MPI_SUCCESS;
+}
+
+int MPI_Finalize(void) {
+  return MPI_SUCCESS;
+}
+
+int MPI_Comm_rank(MPI_Comm comm, int *rank) {
+  (void) comm;
+  *rank = current->rank;
+  return MPI_SUCCESS;
+}
+
+int MPI_Comm_size(MPI_Comm comm, int *size) {
+  (void) comm;
+  *size = nranks;
+  return MPI_SUCCESS;
+}
+
+double MPI_Wtime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+  int len = count * type_size(type);
+  msg_t *m;
+  coro_t *d;
+
+  if (dest == MPI_PROC_NULL) return MPI_SUCCESS;
+  m = malloc(sizeof(*m) + len);
+  m->src = current->rank, m->tag = tag, m->ctx = comm, m->len = len;
+  memcpy(m->data, buf, len);
+
+  d = &ranks[dest];
+  mailbox_push(d, m);
+  if (d->state == BLOCKED && d->waiting_msg) {
+    d->waiting_msg = 0;
+    make_runnable(d);
+  }
+  return MPI_SUCCESS;
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request *req) {
+  *req = &completed_send;
+  return MPI_Send(buf, count, type, dest, tag, comm);
+}
+
+/** Copies m out to a receive of max bytes and frees it. */
+static void deliver(msg_t *m, void *buf, int max, MPI_Status *status) {
+  memcpy(buf, m->data, m->len < max ? m->len : max);
+  if (status != MPI_STATUS_IGNORE) {
+    status->MPI_SOURCE = m->src, status->MPI_TAG = m->tag;
+    status->MPI_ERROR = MPI_SUCCESS, status->count = m->len;
+  }
+  free(m);
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Status *status) {
+  msg_t *m;
+
+  if (source == MPI_PROC_NULL) return MPI_SUCCESS;
+  while (!(m = mailbox_match(current, source, tag, comm))) {
+    current->waiting_msg = 1;
+    block();
+  }
+  deliver(m, buf, count * type_size(type), status);
+  return MPI_SUCCESS;
+}
+
+static void post_recv(void *buf, int count, MPI_Datatype type, int source, int tag, int ctx, MPI_Request *req) {
+  struct shim_request *r = calloc(1, sizeof(*r));
+  r->buf = buf, r->max = count * type_size(type), r->src = source, r->tag = tag, r->ctx = ctx;
+  r->done = (source == MPI_PROC_NULL);
+  *req = r;
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Request *req) {
+  post_recv(buf, count, type, source, tag, comm, req);
+  return MPI_SUCCESS;
+}
+
+/** Whether req has completed, matching a receive if it can. */
+static int progress(MPI_Request req) {
+  msg_t *m;
+
+  if (req == MPI_REQUEST_NULL || req->done) return 1;
+  if (!(m = mailbox_match(current, req->src, req->tag, req->ctx))) return 0;
+  deliver(m, req->buf, req->max, &req->status);
+  req->done = 1;
+  return 1;
+}
+
+/** Hands back a completed request's status and releases it. */
+static void complete(MPI_Request *req, MPI_Status *status) {
+  if (*req != MPI_REQUEST_NULL && *req != &completed_send) {
+    if (status != MPI_STATUS_IGNORE) *status = (*req)->status;
+    free(*req);
+  }
+  *req = MPI_REQUEST_NULL;
+}
+
+int MPI_Request_free(MPI_Request *req) {
+  // A receive nobody will wait on just stops matching
+  if (*req != &completed_send) free(*req);
+  *req = MPI_REQUEST_NULL;
+  return MPI_SUCCESS;
+}
+
+int MPI_Cancel(MPI_Request *req) {
+  // Nothing is matched outside a wait or test, so a pending receive always cancels
+  (*req)->done = 1;
+  return MPI_SUCCESS;
+}
+
+int MPI_Wait(MPI_Request *req, MPI_Status *status) {
+  while (!progress(*req)) {
+    current->waiting_msg = 1;
+    block();
+  }
+  complete(req, status);
+  return MPI_SUCCESS;
+}
+
+int MPI_Waitall(int count, MPI_Request *reqs, MPI_Status *statuses) {
+  int i;
+  for (i = 0; i < count; i++) MPI_Wait(&reqs[i], statuses == MPI_STATUSES_IGNORE ? MPI_STATUS_IGNORE : &statuses[i]);
+  return MPI_SUCCESS;
+}
+
+int MPI_Waitany(int count, MPI_Request *reqs, int *index, MPI_Status *status) {
+  int i, active;
+
+  while (1) {
+    for (i = active = 0; i < count; i++) {
+      if (reqs[i] == MPI_REQUEST_NULL) continue;
+      active = 1;
+      if (progress(reqs[i])) {
+        complete(&reqs[i], status);
+        *index = i;
+        return MPI_SUCCESS;
+      }
+    }
+    if (!active) {
+      *index = MPI_UNDEFINED;
+      return MPI_SUCCESS;
+    }
+    current->waiting_msg = 1;
+    block();
+  }
+}
+
+int MPI_Test(MPI_Request *req, int *flag, MPI_Status *status) {
+  if ((*flag = progress(*req))) complete(req, status);
+  return MPI_SUCCESS;
+}
+
+int MPI_Iprobe(int source, int tag, MPI_Comm comm, int *flag, MPI_Status *status) {
+  msg_t *m;
+
+  mailbox_drain(current);
+  for (m = current->pending; m; m = m->next) {
+    if (m->ctx != comm) continue;
+    if (source != MPI_ANY_SOURCE && m->src != source) continue;
+    if (tag != MPI_ANY_TAG && m->tag != tag) continue;
+    break;
+  }
+  if ((*flag = m != NULL) && status != MPI_STATUS_IGNORE) {
+    status->MPI_SOURCE = m->src, status->MPI_TAG = m->tag;
+    status->MPI_ERROR = MPI_SUCCESS, status->count = m->len;
+  }
+  return MPI_SUCCESS;
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+  coll_arg_t a = { 0 };
+  return collective(comm, COLL_BARRIER, &a);
+}
+
+int MPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm) {
+  coll_arg_t a = { sendbuf, recvbuf, count, type, op, root, NULL, NULL };
+  return collective(comm, COLL_REDUCE, &a);
+}
+
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+  coll_arg_t a = { sendbuf, recvbuf, count, type, op, 0, NULL, NULL };
+  return collective(comm, COLL_ALLREDUCE, &a);
+}
+
+int MPI_Ibcast(void *buf, int count, MPI_Datatype type, int root, MPI_Comm comm, MPI_Request *req) {
+  int i;
+
+  // Point to point in the communicator's collective context (~comm), which no
+  // receive of the program's can match; the root's copies go out at once
+  if (current->rank != root) {
+    post_recv(buf, count, type, root, 0, ~comm, req);
+    return MPI_SUCCESS;
+  }
+  for (i = 0; i < nranks; i++)
+    if (i != root) MPI_Send(buf, count, type, i, 0, ~comm);
+  *req = &completed_send;
+  return MPI_SUCCESS;
+}
+
+int MPI_Comm_dup(MPI_Comm comm, MPI_Comm *newcomm) {
+  coll_arg_t a = { 0 };
+  a.newcomm = newcomm;
+  return collective(comm, COLL_DUP, &a);
+}
+
+int MPI_Comm_free(MPI_Comm *comm) {
+  // Ids are never reused, so a stale message can't match a later communicator
+  *comm = MPI_COMM_NULL;
+  return MPI_SUCCESS;
+}
+
+// File operations don't synchronize: every rank writes its own part directly
+
+int MPI_File_open(MPI_Comm comm, const char *path, int amode, MPI_Info info, MPI_File *fh) {
+  int flags = (amode & MPI_MODE_RDWR) ? O_RDWR : (amode & MPI_MODE_WRONLY) ? O_WRONLY : O_RDONLY;
+  (void) comm, (void) info;
+  if (amode & MPI_MODE_CREATE) flags |= O_CREAT;
+  *fh = open(path, flags, 0644);
+  return *fh < 0 ? MPI_ERR_OTHER : MPI_SUCCESS;
+}
+
+int MPI_File_set_size(MPI_File fh, MPI_Offset size) {
+  return ftruncate(fh, size) ? MPI_ERR_OTHER : MPI_SUCCESS;
+}
+
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf, int count, MPI_Datatype type, MPI_Status *status) {
+  ssize_t len = (ssize_t) count * type_size(type);
+  (void) status;
+  return pwrite(fh, buf, len, offset) == len ? MPI_SUCCESS : MPI_ERR_OTHER;
+}
+
+int MPI_File_close(MPI_File *fh) {
+  close(*fh);
+  *fh = -1;
+  return MPI_SUCCESS;
+}
+
+/*
+ * FG-MPI
+ */
+
+int MPIX_Get_collocated_size(int *size) {
+  *size = nranks;
+  return MPI_SUCCESS;
+}
+
+int MPIX_Get_collocated_startrank(int *startrank) {
+  *startrank = 0;
+  return MPI_SUCCESS;
+}
+
+int MPIX_Yield(void) {
+  make_runnable(current);
+  to_scheduler();
+  return MPI_SUCCESS;
+}
+
+static void report_deadlock(void) {
+  int i, shown = 0, stuck = 0;
+
+  for (i = 0; i < nranks; i++) stuck += (ranks[i].state == BLOCKED);
+  fprintf(stderr, "shim: deadlock, %d of %d ranks blocked:", stuck, nranks);
+  for (i = 0; i < nranks && shown < 16; i++) {
+    if (ranks[i].state != BLOCKED) continue;
+    fprintf(stderr, " %d%s", i, ranks[i].waiting_msg ? "(recv)" : "(collective)");
+    shown++;
+  }
+  fprintf(stderr, "%s\n", stuck > shown ? " ..." : "");
+}
+
+int FGmpiexec(int *argc, char ***argv, FG_LookupPtr_t lookup) {
+  const char *env;
+  char *stacks;
+  int i;
+
+  // Take -np N off the front, as mpiexec would
+  if (*argc >= 3 && !strcmp((*argv)[1], "-np")) {
+    nranks = atoi((*argv)[2]);
+    (*argv)[2] = (*argv)[0];
+    *argc -= 2, *argv += 2;
+  } else if ((env = getenv("SHIM_NP"))) {
+    nranks = atoi(env);
+  }
+  if (nranks <= 0) {
+    fprintf(stderr, "Usage: %s -np <N PROCESSES> [ program arguments ] (or set SHIM_NP)\n", (*argv)[0]);
+    exit(1);
+  }
+
+  env = getenv("SHIM_STACK");
+  stack_size = (size_t) (env ? atoi(env) : STACK_KB_DEFAULT) * 1024;
+  stacks = mmap(NULL, stack_size * nranks, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  ranks = calloc(nranks, sizeof(*ranks));
+  if (stacks == MAP_FAILED || !ranks) {
+    fprintf(stderr, "shim: cannot allocate %d ranks\n", nranks);
+    exit(1);
+  }
+
+  shim_argc = *argc, shim_argv = *argv;
+  new_comm(); // MPI_COMM_WORLD
+
+  FG_MapPtr_t map = lookup(*argc, *argv, "");
+  for (i = 0; i < nranks; i++) {
+    coro_t *c = &ranks[i];
+    c->rank = i;
+    c->fn = map(*argc, *argv, i);
+    c->stack = stacks + (size_t) i * stack_size;
+    *(unsigned long long *) c->stack = STACK_CANARY;
+    ctx_make(&c->ctx, c->stack, stack_size, coro_main);
+    make_runnable(c);
+  }
+  live = nranks;
+
+  while (runq_head) {
+    current = runq_head;
+    runq_head = current->next_run;
+    if (!runq_head) runq_tail = NULL;
+    ctx_switch(&sched_ctx, &current->ctx);
+  }
+
+  fflush(stdout);
+  if (live) {
+    report_deadlock();
+    exit(2);
+  }
+
+  munmap(stacks, stack_size * nranks);
+  return 0;
+}
@@ -0,0 +1,691 @@
+/**
+ * sim.c
+ *
+ * Segmented, work-stealing simulation of hs.c and lcr.c. See sim.h.
+ *
+ * Every message in flight at the start of a window was sent in the round
+ * before it. A message to process i of a segment [0, len) can set off a chain
+ * that reaches another segment no sooner than min(i, len-1-i) + 1 rounds
+ * later, so the window is the smallest such distance over every message in
+ * flight. Within a window each segment works through its rounds alone.
+ *
+ * A segment keeps the messages for its next round in two queues, one for
+ * messages travelling right (from each process's left) and one for those
+ * travelling left. Processes are handled in ring order, so both queues come
+ * out sorted by destination and a round is a merge of the two. Messages that
+ * leave the segment are only needed in the next window; each channel has one
+ * buffer per window parity, so the producer fills one while the consumer
+ * drains the other and the barrier between windows is the only
+ * synchronization.
+ *
+ * Work stealing: each worker owns a contiguous range of segments, packed with
+ * its end into one word. The owner takes from the front and thieves take from
+ * the back, both with a CAS on that word.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "sim.h"
+
+// Tags, as in hs.c and lcr.c
+#define HS_ELECTION 2
+#define HS_REPLY 3
+#define HS_IGNORE 6
+#define LCR_PHASE1 2
+#define LCR_ELECTION 3
+
+#define LEFT 0
+#define RIGHT 1
+
+#define NO_LOOKAHEAD LLONG_MAX
+#define SPINS_BEFORE_YIELD 256
+
+typedef struct {
+  int uid, d;
+  unsigned char k, tag;
+} msg_t;
+
+typedef struct {
+  unsigned at;   // destination, as an offset into the segment
+  msg_t m;
+} entry_t;
+
+typedef struct {
+  entry_t *v;
+  size_t len, cap;
+} queue_t;
+
+// Messages crossing from one segment into the next, one buffer per window parity
+typedef struct {
+  queue_t buf[2];
+} chan_t;
+
+typedef struct {
+  int uid, max_so_far;
+  int reply_uid, reply_k;  // recvReplies[1] in hs.c; recvReplies[0] is never read
+  int phase;               // the last phase this process's own uid went out in
+  int done;
+} hs_node_t;
+
+typedef enum { NONINIT, INIT, LEADER } lcr_state_t;
+
+typedef struct {
+  int uid, max_so_far;
+  short state, done;
+} lcr_node_t;
+
+typedef struct seg {
+  int first, len;
+  void *nodes;
+  queue_t cur[2], next[2];   // [LEFT]: messages from the left neighbour, sorted by destination
+  chan_t in[2];              // [LEFT]: from the last process of the segment to the left
+  struct seg *left, *right;
+  unsigned long long rcvd, sent, messages;
+  int leaders, leader_rank, leader_uid;
+  long long phases[SIM_PHASES];
+  char pad[64];
+} seg_t;
+
+typedef enum { TASK_INIT, TASK_STEP, TASK_FINISH } task_t;
+
+typedef struct {
+  _Atomic unsigned long long range;  // front << 32 | back
+  long long lookahead;               // this worker's smallest lookahead in the window
+  long long last_round;
+  char pad[64 - 2 * sizeof(long long) - sizeof(unsigned long long)];
+} worker_t;
+
+typedef struct {
+  const sim_config_t *cfg;
+  int n, pnum, last;
+  uid_spec_t uids;
+  int nsegs, nthreads;
+  seg_t *segs;
+  worker_t *workers;
+  task_t task;
+  long long round, end;    // the window covers rounds [round, end)
+  long long windows;
+  int window;              // parity picks the channel buffers
+  int done;
+  _Atomic int arrived;
+  _Atomic unsigned gen;
+} sim_t;
+
+typedef struct {
+  sim_t *sim;
+  seg_t *seg;
+  worker_t *w;
+  unsigned at;
+  long long round;
+} ctx_t;
+
+static void oom(void) {
+  fprintf(stderr, "sim: out of memory\n");
+  exit(1);
+}
+
+static void push(queue_t *q, unsigned at, const msg_t *m) {
+  if (q->len == q->cap) {
+    q->cap = q->cap ? 2 * q->cap : 64;
+    q->v = realloc(q->v, q->cap * sizeof(entry_t));
+    if (!q->v) oom();
+  }
+  q->v[q->len].at = at, q->v[q->len++].m = *m;
+}
+
+static long long edge_distance(const seg_t *s, unsigned at) {
+  unsigned to_right = (unsigned) s->len - 1 - at;
+  return (at < to_right ? at : to_right) + 1;
+}
+
+static void lookahead(worker_t *w, long long d) {
+  if (d < w->lookahead) w->lookahead = d;
+}
+
+/**
+ * Sends m from the current process to its left or right neighbour in the next
+ * round. counted says whether the program counts it in lnum_sent.
+ */
+static void send(ctx_t *c, int dir, msg_t m, int counted) {
+  seg_t *s = c->seg;
+  sim_t *sim = c->sim;
+
+  s->messages++;
+  if (counted) s->sent++;
+  if (dir == RIGHT) {
+    if (c->at + 1 < (unsigned) s->len) {
+      push(&s->next[LEFT], c->at + 1, &m);
+      return;
+    }
+    push(&s->right->in[LEFT].buf[(sim->window + 1) & 1], 0, &m);
+  } else {
+    if (c->at > 0) {
+      push(&s->next[RIGHT], c->at - 1, &m);
+      return;
+    }
+    push(&s->left->in[RIGHT].buf[(sim->window + 1) & 1], s->left->len - 1, &m);
+  }
+  // The window was chosen so that nothing crosses a segment edge inside it
+  if (c->round + 1 != sim->end) {
+    fprintf(stderr, "sim: message crossed a segment edge in round %lld of window [%lld, %lld)\n",
+            c->round + 1, sim->round, sim->end);
+    abort();
+  }
+  lookahead(c->w, 1);
+}
+
+static msg_t mk(int uid, int k, int d, int tag) {
+  msg_t m = { uid, d, (unsigned char) k, (unsigned char) tag };
+  return m;
+}
+
+/*
+ * hs.c, one received message at a time. Same branches, including the ones
+ * that never send; k and d are simply the fields of the message.
+ */
+
+static void hs_finish(ctx_t *c, hs_node_t *p) {
+  p->done = 1;
+  send(c, LEFT, mk(p->max_so_far, 0, 0, HS_IGNORE), 0);
+  send(c, RIGHT, mk(p->max_so_far, 0, 0, HS_IGNORE), 0);
+}
+
+static void hs_init(ctx_t *c, hs_node_t *p) {
+  p->max_so_far = p->uid;
+  send(c, LEFT, mk(p->uid, 0, 0, HS_ELECTION), 1);
+  send(c, RIGHT, mk(p->uid, 0, 0, HS_ELECTION), 1);
+}
+
+/** p sends uid out in phase k; counts it if uid is p's own. */
+static void hs_reached(hs_node_t *p, int uid, int k) {
+  if (uid == p->uid && k > p->phase) p->phase = k;
+}
+
+static void hs_recv(ctx_t *c, hs_node_t *p, int from, const msg_t *m) {
+  int k = m->k, d = m->d, last = c->sim->last;
+
+  c->seg->rcvd++;
+  if (m->tag == HS_IGNORE) {
+    if (m->uid > p->max_so_far) p->max_so_far = m->uid;
+    hs_finish(c, p);
+    return;
+  }
+  if (k > last) {
+    hs_finish(c, p);
+    return;
+  }
+
+  if (from == LEFT) {
+    if (m->tag == HS_ELECTION) {
+      if (m->uid > p->uid) {
+        if (d < (1 << k)) send(c, RIGHT, mk(m->uid, k, d + 1, HS_ELECTION), 1);
+        else send(c, LEFT, mk(m->uid, k, 0, HS_REPLY), 1);
+      } else if (m->uid == p->uid) {
+        send(c, RIGHT, mk(p->uid, k + 1, 1, HS_ELECTION), 1);
+        hs_reached(p, p->uid, k + 1);
+      }
+    } else if (m->tag == HS_REPLY) {
+      if (m->uid != p->max_so_far) {
+        if (m->uid > p->max_so_far) p->max_so_far = m->uid;
+      } else {
+        send(c, LEFT, mk(m->uid, k + 1, 1, HS_ELECTION), 1);
+        send(c, RIGHT, mk(m->uid, k + 1, 1, HS_ELECTION), 1);
+        hs_reached(p, m->uid, k + 1);
+      }
+    } else {
+      hs_finish(c, p);
+    }
+    return;
+  }
+
+  if (m->tag == HS_ELECTION) {
+    if (m->uid > p->uid) {
+      if (m->uid > p->max_so_far) p->max_so_far = m->uid;
+      if (d < (1 << k)) send(c, LEFT, mk(m->uid, k, d + 1, HS_ELECTION), 1);
+      else send(c, RIGHT, mk(m->uid, k, 0, HS_REPLY), 1);
+    } else if (m->uid == p->uid) {
+      send(c, LEFT, mk(p->uid, k + 1, 1, HS_ELECTION), 1);
+      hs_reached(p, p->uid, k + 1);
+      if (k >= last && m->uid == p->max_so_far) hs_finish(c, p);
+    }
+  } else if (m->tag == HS_REPLY) {
+    if (m->uid != p->max_so_far) {
+      if (m->uid > p->max_so_far) p->max_so_far = m->uid;
+      p->reply_uid = m->uid, p->reply_k = k;
+    } else if (p->reply_uid == m->uid && p->reply_k == k) {
+      send(c, LEFT, mk(p->uid, k + 1, 1, HS_ELECTION), 1);
+      send(c, RIGHT, mk(p->uid, k + 1, 1, HS_ELECTION), 1);
+      hs_reached(p, p->uid, k + 1);
+    } else {
+      p->reply_uid = m->uid, p->reply_k = k;
+    }
+  } else {
+    hs_finish(c, p);
+  }
+}
+
+/*
+ * lcr.c: the candidate loop, then the forwarding loop
+ */
+
+static void lcr_init(ctx_t *c, lcr_node_t *p) {
+  p->max_so_far = p->uid, p->state = INIT;
+  send(c, RIGHT, mk(p->uid, 0, 0, LCR_PHASE1), 1);
+}
+
+static void lcr_recv(ctx_t *c, lcr_node_t *p, const msg_t *m) {
+  c->seg->rcvd++;
+  if (p->state == INIT) {
+    if (m->tag == LCR_ELECTION || m->uid > p->max_so_far) {
+      p->max_so_far = m->uid, p->state = NONINIT;
+      send(c, RIGHT, *m, 1);
+    } else if (m->uid == p->uid) {
+      p->state = LEADER;
+      send(c, RIGHT, mk(p->uid, 0, 0, LCR_ELECTION), 1);
+    }
+    return;
+  }
+
+  if (p->state == NONINIT && m->tag == LCR_ELECTION) {
+    if (m->uid > p->max_so_far) p->max_so_far = m->uid;
+    send(c, RIGHT, *m, 1);
+    p->done = 1;
+  } else if (p->state == LEADER && m->uid == p->uid && m->tag == LCR_ELECTION) {
+    p->done = 1;
+  } else {
+    send(c, RIGHT, *m, 1);
+  }
+}
+
+/*
+ * Segment tasks
+ */
+
+static size_t node_size(const sim_t *sim) {
+  return sim->cfg->algo == SIM_HS ? sizeof(hs_node_t) : sizeof(lcr_node_t);
+}
+
+static void *node(const sim_t *sim, seg_t *s, unsigned at) {
+  return (char *) s->nodes + at * node_size(sim);
+}
+
+static void deliver(ctx_t *c, int from, const entry_t *e) {
+  void *p = node(c->sim, c->seg, e->at);
+
+  c->at = e->at;
+  if (c->sim->cfg->algo == SIM_HS) {
+    if (((hs_node_t *) p)->done) return;
+    hs_recv(c, p, from, &e->m);
+  } else {
+    if (((lcr_node_t *) p)->done) return;
+    lcr_recv(c, p, &e->m);
+  }
+}
+
+/**
+ * One round of a segment: every process handles what its left neighbour sent
+ * (lhead, then lq) and then what its right neighbour sent (rq, then rtail).
+ */
+static const queue_t none;
+
+static void round_step(ctx_t *c, const queue_t *lhead, const queue_t *lq,
+                       const queue_t *rq, const queue_t *rtail) {
+  const queue_t *from[2][2] = { { lhead, lq }, { rq, rtail } };
+  size_t i[2] = { 0, 0 };
+  int part[2] = { 0, 0 }, side;
+
+  for (;;) {
+    const entry_t *e[2] = { NULL, NULL };
+    for (side = 0; side < 2; side++) {
+      while (part[side] < 2 && i[side] == from[side][part[side]]->len) part[side]++, i[side] = 0;
+      if (part[side] < 2) e[side] = &from[side][part[side]]->v[i[side]];
+    }
+    if (!e[LEFT] && !e[RIGHT]) break;
+    side = (e[LEFT] && (!e[RIGHT] || e[LEFT]->at <= e[RIGHT]->at)) ? LEFT : RIGHT;
+    deliver(c, side, e[side]);
+    i[side]++;
+  }
+}
+
+static void swap_rounds(seg_t *s) {
+  int side;
+  for (side = 0; side < 2; side++) {
+    queue_t t = s->cur[side];
+    s->cur[side] = s->next[side], s->next[side] = t;
+    s->next[side].len = 0;
+  }
+}
+
+static void seg_lookahead(worker_t *w, const seg_t *s) {
+  int side;
+  for (side = 0; side < 2; side++) {
+    if (!s->cur[side].len) continue;
+    lookahead(w, edge_distance(s, s->cur[side].v[0].at));
+    lookahead(w, edge_distance(s, s->cur[side].v[s->cur[side].len - 1].at));
+  }
+}
+
+/**
+ * The uid the program would give rank. rd is the caller's generator state, set
+ * up with initstate_r on 128 bytes like glibc's own rand().
+ */
+static int make_uid(const sim_t *sim, int rank, struct random_data *rd) {
+  int r;
+
+  if (sim->cfg->table) return sim->cfg->table[rank];
+  if (sim->uids.dist != UID_RANDOM) return uid_generate(&sim->uids, rank, sim->n, sim->pnum);
+  // srand(seed + rank); rand() % pnum, as opts_srand and uid_generate do
+  srandom_r((unsigned) (sim->cfg->seed + rank), rd);
+  random_r(rd, &r);
+  return r % sim->pnum;
+}
+
+static void seg_init(sim_t *sim, seg_t *s, worker_t *w) {
+  ctx_t c = { sim, s, w, 0, 0 };
+  struct random_data rd;
+  char state[128];
+  unsigned i;
+
+  s->nodes = calloc(s->len, node_size(sim));
+  if (!s->nodes) oom();
+  memset(&rd, 0, sizeof(rd));
+  initstate_r(1, state, sizeof(state), &rd);
+
+  for (i = 0; i < (unsigned) s->len; i++) {
+    int uid = make_uid(sim, s->first + (int) i, &rd);
+    c.at = i;
+    if (sim->cfg->algo == SIM_HS) {
+      hs_node_t *p = node(sim, s, i);
+      p->uid = uid;
+      hs_init(&c, p);
+    } else {
+      lcr_node_t *p = node(sim, s, i);
+      p->uid = uid;
+      lcr_init(&c, p);
+    }
+  }
+  swap_rounds(s);
+  seg_lookahead(w, s);
+}
+
+static void seg_step(sim_t *sim, seg_t *s, worker_t *w) {
+  ctx_t c = { sim, s, w, 0, sim->round };
+  queue_t *lin = &s->in[LEFT].buf[sim->window & 1], *rin = &s->in[RIGHT].buf[sim->window & 1];
+
+  if (!s->cur[LEFT].len && !s->cur[RIGHT].len && !lin->len && !rin->len) return;
+
+  // Only the first round of a window can have messages from other segments
+  round_step(&c, lin, &s->cur[LEFT], &s->cur[RIGHT], rin);
+  lin->len = rin->len = 0;
+  for (;;) {
+    swap_rounds(s);
+    if (c.round > w->last_round) w->last_round = c.round;
+    if (++c.round == sim->end || (!s->cur[LEFT].len && !s->cur[RIGHT].len)) break;
+    round_step(&c, &none, &s->cur[LEFT], &s->cur[RIGHT], &none);
+  }
+  seg_lookahead(w, s);
+}
+
+static void seg_finish(sim_t *sim, seg_t *s) {
+  unsigned i;
+
+  s->leaders = 0, s->leader_rank = -1;
+  memset(s->phases, 0, sizeof(s->phases));
+  for (i = 0; i < (unsigned) s->len; i++) {
+    int uid, leads;
+    if (sim->cfg->algo == SIM_HS) {
+      hs_node_t *p = node(sim, s, i);
+      uid = p->uid, leads = p->max_so_far == p->uid;
+      s->phases[p->phase]++;
+    } else {
+      lcr_node_t *p = node(sim, s, i);
+      uid = p->uid, leads = p->state == LEADER;
+    }
+    if (!leads) continue;
+    if (!s->leaders++) s->leader_rank = s->first + (int) i, s->leader_uid = uid;
+  }
+}
+
+static void run_task(sim_t *sim, int segi, worker_t *w) {
+  seg_t *s = &sim->segs[segi];
+  switch (sim->task) {
+    case TASK_INIT: seg_init(sim, s, w); break;
+    case TASK_STEP: seg_step(sim, s, w); break;
+    case TASK_FINISH: seg_finish(sim, s); break;
+  }
+}
+
+/*
+ * Scheduling
+ */
+
+#define RANGE(front, back) ((unsigned long long) (front) << 32 | (unsigned) (back))
+
+static int take(worker_t *w) {
+  unsigned long long r = atomic_load(&w->range);
+  while ((unsigned) (r >> 32) < (unsigned) r)
+    if (atomic_compare_exchange_weak(&w->range, &r, r + (1ull << 32))) return (int) (r >> 32);
+  return -1;
+}
+
+static int steal(sim_t *sim, int self) {
+  int i;
+  for (i = 1; i < sim->nthreads; i++) {
+    worker_t *v = &sim->workers[(self + i) % sim->nthreads];
+    unsigned long long r = atomic_load(&v->range);
+    while ((unsigned) (r >> 32) < (unsigned) r)
+      if (atomic_compare_exchange_weak(&v->range, &r, r - 1)) return (int) (unsigned) r - 1;
+  }
+  return -1;
+}
+
+static void deal(sim_t *sim) {
+  int t;
+  for (t = 0; t < sim->nthreads; t++) {
+    long long front = (long long) sim->nsegs * t / sim->nthreads;
+    long long back = (long long) sim->nsegs * (t + 1) / sim->nthreads;
+    atomic_store(&sim->workers[t].range, RANGE(front, back));
+  }
+}
+
+/** Run by the last worker into the barrier: picks the next window. */
+static void next_window(sim_t *sim) {
+  long long look = NO_LOOKAHEAD;
+  int t;
+
+  for (t = 0; t < sim->nthreads; t++) {
+    if (sim->workers[t].lookahead < look) look = sim->workers[t].lookahead;
+    sim->workers[t].lookahead = NO_LOOKAHEAD;
+  }
+
+  sim->windows++, sim->window++;
+  if (sim->task == TASK_FINISH) {
+    sim->done = 1;
+    return;
+  }
+  sim->round = sim->end;
+  if (look == NO_LOOKAHEAD) sim->task = TASK_FINISH;
+  else sim->task = TASK_STEP, sim->end = sim->round + look;
+  deal(sim);
+}
+
+static void barrier(sim_t *sim) {
+  unsigned gen = atomic_load(&sim->gen);
+  int spins = 0;
+
+  if (atomic_fetch_add(&sim->arrived, 1) == sim->nthreads - 1) {
+    next_window(sim);
+    atomic_store(&sim->arrived, 0);
+    atomic_store(&sim->gen, gen + 1);
+    return;
+  }
+  while (atomic_load(&sim->gen) == gen)
+    if (++spins > SPINS_BEFORE_YIELD) sched_yield();
+}
+
+typedef struct {
+  sim_t *sim;
+  int self;
+} arg_t;
+
+static void *worker(void *a) {
+  sim_t *sim = ((arg_t *) a)->sim;
+  int self = ((arg_t *) a)->self, s;
+  worker_t *w = &sim->workers[self];
+
+  while (!sim->done) {
+    while ((s = take(w)) >= 0 || (s = steal(sim, self)) >= 0) run_task(sim, s, w);
+    barrier(sim);
+  }
+  return NULL;
+}
+
+/*
+ * Setup
+ */
+
+const char *sim_algo_name(sim_algo_t algo) {
+  return algo == SIM_HS ? "hs" : "lcr";
+}
+
+static int ceiling_log2(unsigned long long x) {
+  int b = 0;
+  while ((1ull << b) < x) b++;
+  return b;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** LCR on the whole ring with the lcrvec kernel, one round after another. */
+static int run_vector(sim_t *sim, sim_result_t *res) {
+  struct random_data rd;
+  char state[128];
+  lcrvec_t v;
+  int *uids = malloc(sim->n * sizeof(int)), val, tag, i;
+
+  if (!uids) oom();
+  memset(&rd, 0, sizeof(rd));
+  initstate_r(1, state, sizeof(state), &rd);
+  for (i = 0; i < sim->n; i++) uids[i] = make_uid(sim, i, &rd);
+
+  double t0 = now();
+  if (lcrvec_init(&v, sim->n, uids, sim->cfg->isa, &val, &tag)) oom();
+  while (lcrvec_round(&v, val, tag, &val, &tag)) res->rounds++;
+  res->rounds++;
+  res->seconds = now() - t0;
+
+  res->leaders = v.leader >= 0;
+  res->leader_rank = v.leader, res->leader_uid = v.leader >= 0 ? uids[v.leader] : 0;
+  res->trcvd = v.rcvd, res->tsent = res->messages = v.sent;
+  res->segments = 1, res->kernel = lcrvec_isa_name(v.isa);
+  lcrvec_free(&v);
+  free(uids);
+
+  return 0;
+}
+
+int sim_run(const sim_config_t *cfg, sim_result_t *res) {
+  sim_t sim;
+  pthread_t *threads;
+  arg_t *args;
+  int i, k, side;
+
+  if (cfg->n < 3 || cfg->n == INT_MAX) {
+    fprintf(stderr, "sim: ring size must be at least 3\n");
+    return -1;
+  }
+  memset(&sim, 0, sizeof(sim));
+  sim.cfg = cfg, sim.n = cfg->n, sim.uids = cfg->uids;
+  sim.last = ceiling_log2((unsigned long long) cfg->n);
+  sim.nthreads = cfg->threads > 0 ? cfg->threads : 1;
+
+  // The programs' own uids, pnum formula included (hs.c's overflows past 2147 processes)
+  if (cfg->algo == SIM_HS) {
+    sim.pnum = cfg->pnum ? cfg->pnum : (int) (unsigned) (cfg->n * 1000000ll + 1);
+    if (sim.uids.dist == UID_DEFAULT) sim.uids.dist = UID_RANDOM;
+  } else {
+    sim.pnum = cfg->pnum ? cfg->pnum : (cfg->n <= (INT_MAX - 1) / 7 ? 7 * cfg->n + 1 : cfg->n + 1);
+    if (sim.uids.dist == UID_DEFAULT) sim.uids.dist = UID_STRIDE;
+  }
+
+  if (cfg->vector) {
+    if (cfg->algo != SIM_LCR) {
+      fprintf(stderr, "sim: the vector kernel only runs LCR\n");
+      return -1;
+    }
+    memset(res, 0, sizeof(*res));
+    return run_vector(&sim, res);
+  }
+
+  sim.nsegs = cfg->segments > 0 ? cfg->segments : 64 * sim.nthreads;
+  if (!cfg->segments && sim.nsegs > cfg->n / 16) sim.nsegs = cfg->n / 16;
+  if (sim.nsegs > cfg->n) sim.nsegs = cfg->n;
+  if (sim.nsegs < 1) sim.nsegs = 1;
+
+  sim.segs = calloc(sim.nsegs, sizeof(seg_t));
+  sim.workers = calloc(sim.nthreads, sizeof(worker_t));
+  threads = calloc(sim.nthreads, sizeof(pthread_t));
+  args = calloc(sim.nthreads, sizeof(arg_t));
+  if (!sim.segs || !sim.workers || !threads || !args) oom();
+
+  for (i = 0; i < sim.nsegs; i++) {
+    seg_t *s = &sim.segs[i];
+    s->first = (int) ((long long) cfg->n * i / sim.nsegs);
+    s->len = (int) ((long long) cfg->n * (i + 1) / sim.nsegs) - s->first;
+    s->left = &sim.segs[(i + sim.nsegs - 1) % sim.nsegs];
+    s->right = &sim.segs[(i + 1) % sim.nsegs];
+  }
+  for (i = 0; i < sim.nthreads; i++) sim.workers[i].lookahead = NO_LOOKAHEAD;
+
+  // Round 0 starts every process; its messages arrive in round 1
+  sim.task = TASK_INIT, sim.round = 0, sim.end = 1;
+  deal(&sim);
+
+  double t0 = now();
+  for (i = 1; i < sim.nthreads; i++) {
+    args[i].sim = &sim, args[i].self = i;
+    if (pthread_create(&threads[i], NULL, worker, &args[i])) {
+      fprintf(stderr, "sim: could not start worker %d\n", i);
+      exit(1);
+    }
+  }
+  args[0].sim = &sim, args[0].self = 0;
+  worker(&args[0]);
+  for (i = 1; i < sim.nthreads; i++) pthread_join(threads[i], NULL);
+
+  memset(res, 0, sizeof(*res));
+  res->seconds = now() - t0;
+  res->leader_rank = -1;
+  res->windows = sim.windows, res->segments = sim.nsegs, res->kernel = "engine";
+  for (i = 0; i < sim.nthreads; i++)
+    if (sim.workers[i].last_round > res->rounds) res->rounds = sim.workers[i].last_round;
+
+  for (i = 0; i < sim.nsegs; i++) {
+    seg_t *s = &sim.segs[i];
+    res->trcvd += s->rcvd, res->tsent += s->sent, res->messages += s->messages;
+    if (s->leaders && !res->leaders) res->leader_rank = s->leader_rank, res->leader_uid = s->leader_uid;
+    res->leaders += s->leaders;
+    for (k = 0; k < SIM_PHASES; k++) res->phases[k] += s->phases[k];
+    for (side = 0; side < 2; side++) {
+      free(s->cur[side].v), free(s->next[side].v);
+      free(s->in[side].buf[0].v), free(s->in[side].buf[1].v);
+    }
+    free(s->nodes);
+  }
+  free(sim.segs), free(sim.workers), free(threads), free(args);
+  // From the last phase each process got to, to how many got to each phase
+  for (k = SIM_PHASES - 2; k >= 0; k--) res->phases[k] += res->phases[k + 1];
+
+  return 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * sim.h
+ *
+ * Parallel simulator for the hs.c and lcr.c state machines on rings far larger
+ * than any MPI job, for capacity planning.
+ *
+ * The ring is cut into contiguous segments. A window of rounds runs every
+ * segment as one task: worker threads take tasks from their own range of
+ * segments and steal from the other end of someone else's when they run out.
+ * Messages inside a segment stay in per-segment queues; messages that cross
+ * into a neighbouring segment go through a single-producer single-consumer
+ * channel between the two.
+ *
+ * Execution is conservative-synchronous: a message sent in round t is handled
+ * in round t+1, each process handles the messages from its left before those
+ * from its right, and within a side in the order they were sent. A window is
+ * as long as the closest message to a segment edge allows, so nothing crosses
+ * an edge inside a window; windows are one round while the ring is busy and
+ * grow to whole segments once few probes remain. The result depends only on
+ * the ring and the uids, never on thread count, segment count or timing.
+ *
+ * LCR handles one ordered channel per process, so its counts are the same on
+ * every schedule and match the MPI programs exactly. For LCR there is also
+ * the vectorized kernel in common/lcrvec.c, which runs the same rounds over
+ * the whole ring on one thread. hs.c reads from both
+ * neighbours with MPI_ANY_SOURCE and its counts vary from run to run; the
+ * simulator runs one of its legal schedules.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "uid.h"
+#include "lcrvec.h"
+
+typedef enum { SIM_HS, SIM_LCR } sim_algo_t;
+
+#define SIM_PHASES 33 // hs.c phases 0 to ceil(log2 n) + 1, for any int n
+
+typedef struct {
+  sim_algo_t algo;
+  int n;            // ring size, at least 3
+  int pnum;         // 0 picks the program's own: n*1000000+1 for hs, 7n+1 for lcr
+  uid_spec_t uids;  // UID_DEFAULT picks random for hs, stride for lcr, as the programs do
+  const int *table; // if set, rank i's uid is table[i] and uids is ignored
+  long seed;        // random uids draw srand(seed + rank); rand() exactly like opts_srand
+  int threads;      // worker threads, 0 for one
+  int segments;     // 0 picks 64 per thread, at most n/16
+  int vector;       // LCR only: run the whole ring on one thread with the lcrvec kernel instead
+  lcrvec_isa_t isa; // the kernel's instruction set when vector is set
+} sim_config_t;
+
+typedef struct {
+  int leader_rank, leader_uid;
+  int leaders;                   // processes that ended up thinking they lead; 1 unless hs.c misbehaves
+  unsigned long long trcvd, tsent; // what the program's Leader line would print
+  unsigned long long messages;   // every message simulated, including hs.c's end-of-election ones
+  long long rounds;              // synchronous rounds until the ring went quiet
+  long long phases[SIM_PHASES];  // hs: processes whose own uid went out in phase k or later; phases[0] is n
+  long long windows;
+  int segments;
+  const char *kernel;            // "engine", or the lcrvec instruction set
+  double seconds;
+} sim_result_t;
+
+/**
+ * Runs one election. Returns 0, or -1 (with a message on stderr) if the
+ * configuration is bad or memory runs out.
+ */
+int sim_run(const sim_config_t *cfg, sim_result_t *res);
+
+/** "hs" or "lcr". */
+const char *sim_algo_name(sim_algo_t algo);
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * simtrials.c
+ *
+ * Usage:
+ * ./sim/simtrials [ -a hs | lcr ] -n <ring size> [ -r <trials> ] [ -u <uid distribution> ] [ -s <seed> ]
+ *                 [ -T <threads> ] [ -B <bins> ] [ -o <summary file> ]
+ *
+ * Monte Carlo over many elections on the simulator in sim.c: <trials>
+ * (default 1000) independent elections, each on freshly drawn uids. Unless -u
+ * says otherwise they are a uniformly random permutation of 0..n-1, shuffled
+ * by Fisher-Yates for every trial (-u perm is a cheap seeded bijection, not
+ * uniform on small rings). Trial t shuffles with seed + t, keys perm and
+ * clustered on it and draws random uids from seed + t * n, so a seeded run
+ * repeats exactly. Worker threads (-T, default every online CPU) take trials from a
+ * shared counter and run each one on a single thread, so trials never wait
+ * on each other.
+ *
+ * The summary (stdout, or the -o file) gives for the messages (the Leader
+ * line's tsent), the synchronous rounds until the ring went quiet (the
+ * latency) and the simulation time: the mean with its 95% confidence
+ * interval, the standard deviation, min, median, 99th percentile and max,
+ * and for tsent and the time a histogram of <bins> (default 20) equal bins.
+ * The rounds get no histogram: the ring goes quiet once the winner's laps and
+ * the end of the election are done, which depends on n and not on the uids,
+ * so they are the same in every trial. What the uids do change in HS is how
+ * far the other candidates get, so for HS the same statistics, without a
+ * histogram, are given for the number of processes whose own uid went out in
+ * each phase from 1 on (Stat phaseK). For LCR on
+ * shuffled uids it also checks the mean against the expected n*H_n messages
+ * of the election plus the n of the TAG_ELECTION lap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "sim.h"
+
+// Per-trial values
+enum { M_TSENT, M_ROUNDS, M_SECONDS, METRICS };
+static const char *metric_names[] = { "tsent", "rounds", "seconds" };
+
+typedef struct {
+  const sim_config_t *cfg;
+  int shuffle;   // Fisher-Yates uids instead of cfg->uids
+  int trials;
+  long seed;
+  _Atomic int next;
+  _Atomic int failed;
+  double (*values)[METRICS];
+  long long (*phases)[SIM_PHASES]; // sim_result_t's, per trial
+} trials_t;
+
+static void usage(void) {
+  printf("Usage: ./sim/simtrials [ -a hs | lcr ] -n <ring size> [ -r <trials> ] [ -u <uid distribution> ] "
+         "[ -s <seed> ] [ -T <threads> ] [ -B <bins> ] [ -o <summary file> ]\n");
+  exit(1);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** splitmix64, for the shuffle. */
+static unsigned long long next_random(unsigned long long *state) {
+  unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+static void *worker(void *arg) {
+  trials_t *tr = arg;
+  sim_config_t cfg = *tr->cfg;
+  sim_result_t res;
+  int *table = NULL, t, i;
+
+  cfg.threads = 1;
+  if (tr->shuffle && !(table = malloc(cfg.n * sizeof(int)))) {
+    fprintf(stderr, "simtrials: out of memory\n");
+    exit(1);
+  }
+  cfg.table = table;
+  while ((t = atomic_fetch_add(&tr->next, 1)) < tr->trials) {
+    cfg.uids.seed = (unsigned) (tr->seed + t);
+    cfg.seed = tr->seed + (long) t * cfg.n;
+    if (table) {
+      unsigned long long state = (unsigned long long) (tr->seed + t);
+      for (i = 0; i < cfg.n; i++) table[i] = i;
+      for (i = cfg.n - 1; i > 0; i--) {
+        int j = (int) (next_random(&state) % (unsigned long long) (i + 1)), x = table[i];
+        table[i] = table[j], table[j] = x;
+      }
+    }
+    if (sim_run(&cfg, &res) || res.leaders != 1) atomic_fetch_add(&tr->failed, 1);
+    tr->values[t][M_TSENT] = res.tsent;
+    tr->values[t][M_ROUNDS] = res.rounds;
+    tr->values[t][M_SECONDS] = res.seconds;
+    memcpy(tr->phases[t], res.phases, sizeof(res.phases));
+  }
+  free(table);
+  return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Prints the statistics and, unless bins is 0, the histogram of one metric;
+ * returns the mean and sets *ci.
+ */
+static double summarize(FILE *out, const char *name, const double *v, int count, int bins, double *ci) {
+  double *sorted = malloc(count * sizeof(double)), sum = 0, sq = 0, mean, sd;
+  int *hist = calloc(bins ? bins : 1, sizeof(int)), i;
+
+  if (!sorted || !hist) {
+    fprintf(stderr, "simtrials: out of memory\n");
+    exit(1);
+  }
+  for (i = 0; i < count; i++) sorted[i] = v[i], sum += v[i];
+  mean = sum / count;
+  for (i = 0; i < count; i++) sq += (v[i] - mean) * (v[i] - mean);
+  sd = count > 1 ? sqrt(sq / (count - 1)) : 0;
+  *ci = 1.96 * sd / sqrt(count);
+  qsort(sorted, count, sizeof(double), cmp_double);
+
+  double lo = sorted[0], hi = sorted[count - 1], width = (hi - lo) / bins;
+  fprintf(out, "Stat %s: mean=%.6g, ci95=[%.6g, %.6g], sd=%.6g, min=%.6g, p50=%.6g, p99=%.6g, max=%.6g\n", name,
+          mean, mean - *ci, mean + *ci, sd, lo, sorted[count / 2], sorted[(int) (0.99 * (count - 1))], hi);
+
+  // Equal bins over [min, max]; the top bin is closed
+  for (i = 0; bins && i < count; i++) {
+    int b = width > 0 ? (int) ((v[i] - lo) / width) : 0;
+    hist[b < bins ? b : bins - 1]++;
+  }
+  for (i = 0; i < bins && (width > 0 || !i); i++)
+    fprintf(out, "Histogram %s: lo=%.6g, hi=%.6g, count=%d\n", name, lo + i * width, lo + (i + 1) * width, hist[i]);
+
+  free(sorted), free(hist);
+  return mean;
+}
+
+int main(int argc, char *argv[]) {
+  sim_config_t cfg;
+  trials_t tr;
+  const char *path = NULL;
+  int threads = (int) sysconf(_SC_NPROCESSORS_ONLN), bins = 20, i, m;
+  long seed = -1;
+
+  memset(&cfg, 0, sizeof(cfg));
+  memset(&tr, 0, sizeof(tr));
+  cfg.algo = SIM_HS, tr.trials = 1000, tr.shuffle = 1;
+
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] != '-' || !argv[i][1] || argv[i][2] || i + 1 >= argc) usage();
+    const char *val = argv[++i];
+    switch (argv[i-1][1]) {
+      case 'a':
+        if (!strcmp(val, "hs")) cfg.algo = SIM_HS;
+        else if (!strcmp(val, "lcr")) cfg.algo = SIM_LCR;
+        else usage();
+        break;
+      case 'n': cfg.n = atoi(val); break;
+      case 'r': tr.trials = atoi(val); if (tr.trials < 1) usage(); break;
+      case 'u': if (uid_parse(val, &cfg.uids)) usage(); tr.shuffle = 0; break;
+      case 's': seed = atol(val); if (seed < 0) usage(); break;
+      case 'T': threads = atoi(val); if (threads < 1) usage(); break;
+      case 'B': bins = atoi(val); if (bins < 1) usage(); break;
+      case 'o': path = val; break;
+      default: usage();
+    }
+  }
+  if (cfg.n < 3 || cfg.uids.dist == UID_LOAD) usage();
+  if (threads > tr.trials) threads = tr.trials;
+
+  FILE *out = path ? fopen(path, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "simtrials: cannot write %s\n", path);
+    exit(1);
+  }
+
+  tr.cfg = &cfg;
+  tr.seed = seed < 0 ? time(NULL) : seed;
+  tr.values = malloc(tr.trials * sizeof(*tr.values));
+  tr.phases = malloc(tr.trials * sizeof(*tr.phases));
+  pthread_t *tids = malloc(threads * sizeof(pthread_t));
+  if (!tr.values || !tr.phases || !tids) {
+    fprintf(stderr, "simtrials: out of memory\n");
+    exit(1);
+  }
+
+  double t0 = now();
+  for (i = 1; i < threads; i++) {
+    if (pthread_create(&tids[i], NULL, worker, &tr)) {
+      fprintf(stderr, "simtrials: could not start worker %d\n", i);
+      exit(1);
+    }
+  }
+  worker(&tr);
+  for (i = 1; i < threads; i++) pthread_join(tids[i], NULL);
+  double elapsed = now() - t0;
+
+  fprintf(out, "Trials: algorithm=%s, n=%d, trials=%d, uids=%s, seed=%ld, threads=%d, failed=%d, seconds=%.3f, "
+          "trials_per_sec=%.1f\n", sim_algo_name(cfg.algo), cfg.n, tr.trials,
+          tr.shuffle ? "shuffled" : uid_name(&cfg.uids), tr.seed, threads, atomic_load(&tr.failed), elapsed,
+          tr.trials / elapsed);
+
+  // One column at a time
+  double *col = malloc(tr.trials * sizeof(double)), mean[METRICS], ci[METRICS];
+  for (m = 0; m < METRICS; m++) {
+    for (i = 0; i < tr.trials; i++) col[i] = tr.values[i][m];
+    mean[m] = summarize(out, metric_names[m], col, tr.trials, m == M_ROUNDS ? 0 : bins, &ci[m]);
+  }
+
+  // Phase 0 is every process; from phase 1, the candidates still in it
+  for (m = 1; cfg.algo == SIM_HS && m < SIM_PHASES; m++) {
+    char name[16];
+    double pci;
+    int any = 0;
+    for (i = 0; i < tr.trials; i++) col[i] = tr.phases[i][m], any |= tr.phases[i][m] > 0;
+    if (!any) break;
+    snprintf(name, sizeof(name), "phase%d", m);
+    summarize(out, name, col, tr.trials, 0, &pci);
+  }
+
+  if (cfg.algo == SIM_LCR && tr.shuffle) {
+    double h = 0;
+    for (i = 1; i <= cfg.n; i++) h += 1.0 / i;
+    double expect = cfg.n * h + cfg.n;
+    fprintf(out, "Expected tsent: n*H_n+n=%.6g, %s the 95%% interval\n", expect,
+            fabs(mean[M_TSENT] - expect) <= ci[M_TSENT] ? "inside" : "outside");
+  }
+
+  if (path) fclose(out);
+  free(col), free(tids), free(tr.values), free(tr.phases);
+  return atomic_load(&tr.failed) ? 1 : 0;
+}
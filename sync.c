@@ -0,0 +1,272 @@
+/**
+ * sync.c
+ *
+ * Usage:
+ * mpiexec -n <N PROCESSES> ./sync [ -a hs|lcr ] [ -x alltoall|ineighbor|isend ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>
+ * (uids are random unless -u says otherwise; ties go to the higher rank)
+ *
+ * HS and LCR in synchronous rounds, the model the hs.c header analyses. The
+ * ring is a periodic 1-D MPI_Cart_create communicator, and every round each
+ * process sends a fixed number of slots each way the algorithm sends (3 both
+ * ways for HS, 1 to the right for LCR, enough for everything one round can
+ * produce), unused slots holding a null message. Messages received in round t
+ * are handled at its end, those from the left first, and what they produce
+ * goes out in round t+1. The rounds are exchanged with (-x):
+ *   alltoall   one MPI_Neighbor_alltoallv per round (default), counts sized
+ *              by the slots each way, so no mode moves more than it uses
+ *   ineighbor  MPI_Ineighbor_alltoallv and MPI_Wait
+ *   isend      one MPI_Isend per message, the way the asynchronous programs
+ *              send, with a null message only where a side has nothing;
+ *              the last message of a round to each side is marked
+ *
+ * When the leader finds out, it sends the result right with the round every
+ * process stops after, the round the leader's left neighbour will get it in,
+ * so every process makes the same number of calls. Rank 0 prints the rounds,
+ * the messages (not counting nulls), the null slots or markers exchanged and
+ * the time per round.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <fgmpi.h>
+#include "options.h"
+
+// Message types; NONE fills an empty slot
+enum { NONE, OUT, IN, ELECTED };
+
+// Tags, for -x isend
+#define TAG_TO_RIGHT 2
+#define TAG_TO_LEFT 3
+
+// { type, uid, rank, hops left (OUT) or the last round (ELECTED), last of the round (isend) }
+#define SIZE_MSG 5
+#define MAX_SLOTS 3
+#define QUEUE 16
+
+typedef enum { X_ALLTOALL, X_INEIGHBOR, X_ISEND } exchange_t;
+
+static const char *exchange_names[] = { "alltoall", "ineighbor", "isend" };
+
+typedef struct {
+  int msg[2][QUEUE][SIZE_MSG]; // waiting to go left (0) and right (1)
+  int len[2];
+} outbox_t;
+
+/** FG-MPI Boilerplate begins **/
+int sync_ring(int argc, char* argv[]);
+
+FG_ProcessPtr_t binding_func(int argc, char** argv, int rank) {
+  return (&sync_ring);
+}
+
+FG_MapPtr_t map_lookup(int argc, char** argv, char* str) {
+  return (&binding_func);
+}
+
+int main(int argc, char *argv[]) {
+  FGmpiexec(&argc, &argv, &map_lookup);
+  return 0;
+}
+
+/** FG-MPI Boilerplate ends **/
+
+
+static void post(outbox_t *box, int dir, int type, int uid, int rank, int hops) {
+  if (box->len[dir] == QUEUE) {
+    printf("sync: more than %d messages waiting to go one way\n", QUEUE);
+    exit(1);
+  }
+  int *m = box->msg[dir][box->len[dir]++];
+  m[0] = type, m[1] = uid, m[2] = rank, m[3] = hops, m[4] = 0;
+}
+
+/** Orders uids, then ranks, so equal uids still have one winner. */
+static int beats(int uid, int rank, int my_uid, int my_rank) {
+  return uid > my_uid || (uid == my_uid && rank > my_rank);
+}
+
+/**
+ * One round: moves up to slots[dir] messages each way from box into the send
+ * buffer and swaps them with the neighbours. slots[0] go left and slots[1]
+ * right, so what comes in from the left is slots[1] long. Returns the null
+ * slots or markers sent.
+ */
+static int exchange(outbox_t *box, const int slots[2], int send[2][MAX_SLOTS][SIZE_MSG],
+                    int recv[2][MAX_SLOTS][SIZE_MSG], exchange_t x, int left, int right, MPI_Comm cart) {
+  int dir, i, n[2], nulls = 0;
+  MPI_Request request;
+
+  for (dir = 0; dir < 2; dir++) {
+    n[dir] = box->len[dir] < slots[dir] ? box->len[dir] : slots[dir];
+    memcpy(send[dir], box->msg[dir], n[dir] * sizeof(send[dir][0]));
+    memmove(box->msg[dir], box->msg[dir][n[dir]], (box->len[dir] - n[dir]) * sizeof(box->msg[dir][0]));
+    box->len[dir] -= n[dir];
+    for (i = n[dir]; i < slots[dir]; i++) send[dir][i][0] = NONE;
+  }
+
+  if (x != X_ISEND) {
+    // Neighbour order on a 1-D Cartesian ring is left, then right
+    int scounts[2], rcounts[2], displs[2] = { 0, MAX_SLOTS * SIZE_MSG };
+    for (dir = 0; dir < 2; dir++) scounts[dir] = slots[dir] * SIZE_MSG, rcounts[dir] = slots[!dir] * SIZE_MSG;
+    if (x == X_ALLTOALL) {
+      MPI_Neighbor_alltoallv(send, scounts, displs, MPI_INT, recv, rcounts, displs, MPI_INT, cart);
+    } else {
+      MPI_Ineighbor_alltoallv(send, scounts, displs, MPI_INT, recv, rcounts, displs, MPI_INT, cart, &request);
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    return slots[0] + slots[1] - n[0] - n[1];
+  }
+
+  MPI_Request requests[2 * MAX_SLOTS];
+  int count = 0;
+  for (dir = 0; dir < 2; dir++) {
+    if (!slots[dir]) continue;
+    if (!n[dir]) n[dir] = 1, nulls++;
+    send[dir][n[dir] - 1][4] = 1;
+    for (i = 0; i < n[dir]; i++)
+      MPI_Isend(send[dir][i], SIZE_MSG, MPI_INT, dir ? right : left, dir ? TAG_TO_RIGHT : TAG_TO_LEFT, cart,
+                &requests[count++]);
+  }
+  for (dir = 0; dir < 2; dir++) {
+    if (!slots[!dir]) continue;
+    i = 0;
+    do {
+      MPI_Recv(recv[dir][i], SIZE_MSG, MPI_INT, dir ? right : left, dir ? TAG_TO_LEFT : TAG_TO_RIGHT, cart,
+               MPI_STATUS_IGNORE);
+    } while (!recv[dir][i++][4]);
+    for (; i < slots[!dir]; i++) recv[dir][i][0] = NONE;
+  }
+  MPI_Waitall(count, requests, MPI_STATUSES_IGNORE);
+  return nulls;
+}
+
+int sync_ring(int argc, char *argv[]) {
+
+  run_opts_t opts;
+  char *args[OPTS_MAX_ARGS + 1];
+  int hs = 1;
+  exchange_t x = X_ALLTOALL;
+  argc = opts_parse(argc, argv, &opts, args), argv = args;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (!strcmp(argv[1], "-a") && !strcmp(argv[2], "hs")) {
+      hs = 1;
+    } else if (!strcmp(argv[1], "-a") && !strcmp(argv[2], "lcr")) {
+      hs = 0;
+    } else if (!strcmp(argv[1], "-x")) {
+      for (x = X_ALLTOALL; x <= X_ISEND && strcmp(argv[2], exchange_names[x]); x++);
+      if (x > X_ISEND) break;
+    } else {
+      break;
+    }
+    argv += 2, argc -= 2;
+  }
+  if (argc != 2 || opts.stats_path || opts.timing) {
+    printf("Usage: ./sync [ -a hs|lcr ] [ -x alltoall|ineighbor|isend ] [ -u <uid distribution> ] [ -s <seed> ] <Process number>\n");
+    exit(1);
+  }
+  int pnum = atoi(argv[1]);
+
+  int rank, size;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  if (size < 3) {
+    printf("Usage: the ring needs at least 3 processes\n");
+    exit(1);
+  }
+
+  // No reordering, so ranks and uids stay where -u put them
+  MPI_Comm cart;
+  int periodic = 1, left, right;
+  MPI_Cart_create(MPI_COMM_WORLD, 1, &size, &periodic, 0, &cart);
+  MPI_Cart_shift(cart, 0, 1, &left, &right);
+
+  opts_srand(&opts, rank);
+  if (opts.uids.dist == UID_DEFAULT) opts.uids.dist = UID_RANDOM;
+  int uid = uid_generate(&opts.uids, rank, size, pnum);
+
+  int slots[2] = { hs ? 3 : 0, hs ? 3 : 1 }, phase = 0, replies = 0, leader_rank = -1, leader_uid = 0;
+  int send[2][MAX_SLOTS][SIZE_MSG], recv[2][MAX_SLOTS][SIZE_MSG];
+  long long round = 0, last = -1, elected_round = 0, sent = 0, rcvd = 0, nulls = 0;
+  outbox_t box = { .len = { 0, 0 } };
+  int dir, i;
+
+  if (hs) {
+    post(&box, 0, OUT, uid, rank, 1);
+    post(&box, 1, OUT, uid, rank, 1);
+  } else {
+    post(&box, 1, OUT, uid, rank, 0);
+  }
+
+  MPI_Barrier(cart);
+  double t_start = MPI_Wtime();
+
+  // Stop after the last round once it is known
+  while (last < 0 || round < last) {
+    sent += (box.len[0] < slots[0] ? box.len[0] : slots[0]) + (box.len[1] < slots[1] ? box.len[1] : slots[1]);
+    nulls += exchange(&box, slots, send, recv, x, left, right, cart);
+    round++;
+
+    for (dir = 0; dir < 2; dir++) {
+      int back = dir, on = !dir; // answer towards where it came from, relay away from it
+      for (i = 0; i < slots[!dir]; i++) {
+        int *m = recv[dir][i], mine = (m[1] == uid && m[2] == rank);
+        if (m[0] == NONE) continue;
+        rcvd++;
+
+        switch (m[0]) {
+          case OUT:
+            if (mine) {
+              // Round the whole ring: tell everyone, and when to stop
+              if (leader_rank < 0) {
+                leader_rank = rank, leader_uid = uid, elected_round = round;
+                last = round + size - 1;
+                post(&box, 1, ELECTED, uid, rank, (int) last);
+              }
+            } else if (beats(m[1], m[2], uid, rank)) {
+              if (!hs) post(&box, on, OUT, m[1], m[2], 0);
+              else if (m[3] > 1) post(&box, on, OUT, m[1], m[2], m[3] - 1);
+              else post(&box, back, IN, m[1], m[2], 0);
+            }
+            break;
+
+          case IN:
+            if (!mine) {
+              post(&box, on, IN, m[1], m[2], 0);
+            } else if (++replies == 2) {
+              replies = 0, phase++;
+              post(&box, 0, OUT, uid, rank, 1 << phase);
+              post(&box, 1, OUT, uid, rank, 1 << phase);
+            }
+            break;
+
+          case ELECTED:
+            leader_rank = m[2], leader_uid = m[1], last = m[3];
+            if (right != leader_rank) post(&box, 1, ELECTED, m[1], m[2], m[3]);
+            break;
+        }
+      }
+    }
+  }
+  double elapsed = MPI_Wtime() - t_start;
+
+  long long local[3] = { rcvd, sent, nulls }, total[3];
+  double t_max;
+  MPI_Reduce(local, total, 3, MPI_LONG_LONG, MPI_SUM, 0, cart);
+  MPI_Reduce(&elapsed, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, cart);
+  MPI_Bcast(&elected_round, 1, MPI_LONG_LONG, leader_rank, cart);
+
+  if (!rank) {
+    printf("Leader: rank=%d, id=%d, trcvd=%lld, tsent=%lld, uids=%s\n", leader_rank, leader_uid, total[0], total[1],
+           uid_name(&opts.uids));
+    printf("Sync: algorithm=%s, exchange=%s, slots=%d, rounds=%lld, to_leader=%lld, msgs=%lld, nulls=%lld, "
+           "seconds=%.6f, us_per_round=%.3f\n", hs ? "hs" : "lcr", exchange_names[x], slots[1], round, elected_round,
+           total[1], total[2], t_max, 1e6 * t_max / round);
+  }
+
+  MPI_Comm_free(&cart);
+  MPI_Finalize();
+  return 0;
+}